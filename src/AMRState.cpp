@@ -0,0 +1,476 @@
+/* Function definition file for adaptive mesh refinement over a simulation */
+
+// Include header definitions
+#include "headers/AMRState.h"
+
+// Includes and usings
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+// Macros
+#define ind(i,j) ((i) + (Nx + 2)*(j))
+
+
+
+//// PUBLIC METHODS ////
+
+// Constructor, starting with no patches until the first regrid
+AMRState::AMRState(SimState * base)
+{
+    this -> base = base;
+
+    // Patches cover whole parent cells, so the cells across must be even
+    patchSize = max(4, base -> params.amrPatchSize + base -> params.amrPatchSize % 2);
+    bufferSize = 4;
+
+    threadPool = new ThreadPool(base -> params.numThreads);
+    Regrid();
+}
+
+// Destructor
+AMRState::~AMRState()
+{
+    ResetState();
+    delete threadPool;
+}
+
+// Fill buffers of each level from the coarsest, step the base and then each level in
+// turn, then average every level back into its parent from the finest
+void AMRState::SimulationStep(float timeStep)
+{
+    // Buffers read neighbors and parents as they stand before the step
+    for(size_t l = 0; l < patches.size(); l++){
+        std::vector<Patch *> & level = patches[l];
+        threadPool -> ParallelFor(0, level.size(), [&](int kStart, int kEnd){
+            for(int k = kStart; k < kEnd; k++){
+                FillFromParent(level[k], false);
+            }
+        });
+    }
+
+    // Patches of a level step side by side once their parents have, projecting against
+    // the pressure the parents reached at their edges
+    base -> SimulationStep(timeStep);
+    for(size_t l = 0; l < patches.size(); l++){
+        std::vector<Patch *> & level = patches[l];
+        threadPool -> ParallelFor(0, level.size(), [&](int kStart, int kEnd){
+            for(int k = kStart; k < kEnd; k++){
+                SimState * state = level[k] -> state;
+                FillPressureFromParent(level[k]);
+                state -> params = PatchParams(l + 1, state -> GetNx());
+                state -> SimulationStep(timeStep);
+            }
+        });
+    }
+
+    for(size_t l = patches.size(); l-- > 0;){
+        std::vector<Patch *> & level = patches[l];
+        threadPool -> ParallelFor(0, level.size(), [&](int kStart, int kEnd){
+            for(int k = kStart; k < kEnd; k++){
+                RestrictToParent(level[k]);
+            }
+        });
+    }
+
+    Regrid();
+}
+
+// Remove every patch, leaving the base as it is
+void AMRState::ResetState()
+{
+    for(std::vector<Patch *> & level : patches){
+        for(Patch * patch : level){
+            delete patch -> state;
+            delete patch;
+        }
+    }
+    patches.clear();
+    table.clear();
+}
+
+// Add patches over quadrants whose parent needs refinement there and remove the rest,
+// level by level from the coarsest, so new patches start from refined parents
+void AMRState::Regrid()
+{
+    // Start over if the base was resized, as patch positions no longer match
+    if(!table.empty() && (int)table[0].size() != PatchesAcross(1, base -> GetNx()) * PatchesAcross(1, base -> GetNy())){
+        ResetState();
+    }
+
+    // Drop levels beyond those requested, finest first so none has children
+    int levels = max(0, base -> params.amrLevels);
+    while((int)patches.size() > levels){
+        while(!patches.back().empty()){
+            DeletePatch(patches.back().back());
+        }
+        patches.pop_back();
+        table.pop_back();
+    }
+    patches.resize(levels);
+    table.resize(levels);
+
+    for(int l = 1; l <= levels; l++){
+        int across = PatchesAcross(l, base -> GetNx());
+        int up = PatchesAcross(l, base -> GetNy());
+        table[l - 1].resize(across * up, nullptr);
+        float extent = PatchExtent(l);
+
+        for(int y = 0; y < up; y++){
+            for(int x = 0; x < across; x++){
+
+                // Parent covering this quadrant, if refined that far
+                Patch * parent = l == 1 ? nullptr : table[l - 2][x / 2 + PatchesAcross(l - 1, base -> GetNx()) * (y / 2)];
+                bool wanted = l == 1 || parent != nullptr;
+
+                // Cells of parent over this quadrant, with two more on each side so
+                // patches are in place before features reach them
+                if(wanted){
+                    SimState * state = l == 1 ? base : parent -> state;
+                    Frame frame = l == 1 ? BaseFrame() : PatchFrame(parent);
+                    int cells = lround(extent / frame.h);
+                    int iStart = lround((x * extent - frame.x) / frame.h) + 1;
+                    int jStart = lround((y * extent - frame.y) / frame.h) + 1;
+                    wanted = NeedsRefinement(state, max(1, iStart - 2), min(state -> GetNx() + 1, iStart + cells + 2),
+                                                    max(1, jStart - 2), min(state -> GetNy() + 1, jStart + cells + 2));
+                }
+
+                Patch * & patch = table[l - 1][x + across * y];
+                if(wanted && patch == nullptr){
+                    patch = CreatePatch(l, x, y, parent);
+                }else if(!wanted && patch != nullptr){
+                    DeletePatch(patch);
+                }
+            }
+        }
+    }
+}
+
+// Simulation refined
+SimState * AMRState::Base() { return base; }
+
+// Number of refined levels
+int AMRState::GetLevels() { return patches.size(); }
+
+// Number of patches of a level, the base being level 0
+int AMRState::GetPatches(int level) { return level == 0 ? 1 : patches[level - 1].size(); }
+
+
+//// PRIVATE METHODS ////
+
+// Make patch over quadrant (x, y) of level, filled from its parent
+AMRState::Patch * AMRState::CreatePatch(int level, int x, int y, Patch * parent)
+{
+    Patch * patch = new Patch{level, x, y, nullptr, parent, {nullptr, nullptr, nullptr, nullptr}};
+    int iStart, iEnd, jStart, jEnd;
+    int Nx = PatchCells(level, x, base -> GetNx(), iStart, iEnd);
+    int Ny = PatchCells(level, y, base -> GetNy(), jStart, jEnd);
+    patch -> state = new SimState(Nx, Ny, PatchParams(level, Nx));
+
+    // Sides with buffers take their ghost cells from the fill, the rest are walls of the base
+    patch -> state -> SetBoundaryHeld((iStart > 1 ? SimState::leftSide : 0) | (iEnd <= Nx ? SimState::rightSide : 0) |
+                                      (jStart > 1 ? SimState::bottomSide : 0) | (jEnd <= Ny ? SimState::topSide : 0));
+    FillFromParent(patch, true);
+    FillPressureFromParent(patch);
+
+    if(parent){
+        parent -> children[x % 2 + 2 * (y % 2)] = patch;
+    }
+    patches[level - 1].push_back(patch);
+    return patch;
+}
+
+// Remove patch and the patches refining it
+void AMRState::DeletePatch(Patch * patch)
+{
+    for(Patch * child : patch -> children){
+        if(child){
+            DeletePatch(child);
+        }
+    }
+
+    // Unlink from parent and tables
+    if(patch -> parent){
+        patch -> parent -> children[patch -> x % 2 + 2 * (patch -> y % 2)] = nullptr;
+    }
+    std::vector<Patch *> & level = patches[patch -> level - 1];
+    level.erase(std::find(level.begin(), level.end(), patch));
+    table[patch -> level - 1][patch -> x + PatchesAcross(patch -> level, base -> GetNx()) * patch -> y] = nullptr;
+
+    delete patch -> state;
+    delete patch;
+}
+
+// Fill buffer and ghost cells of patch, or every cell if interior is set, copying cells
+// of patches of its level where they cover the cell and interpolating its parent
+// elsewhere, and interpolate sources of parent into every cell. Ghost cells on walls of
+// the base are filled as well, though the patch evaluates the walls there itself
+void AMRState::FillFromParent(Patch * patch, bool interior)
+{
+    SimState * state = patch -> state;
+    SimState * parent = ParentState(patch);
+    Frame frame = PatchFrame(patch);
+    Frame parentFrame = ParentFrame(patch);
+    int Nx = state -> GetNx();
+    int Ny = state -> GetNy();
+    int pNx = parent -> GetNx();
+    int pNy = parent -> GetNy();
+
+    for(int j = 0; j <= Ny + 1; j++){
+        for(int i = 0; i <= Nx + 1; i++){
+            float X = frame.x + (i - 0.5) * frame.h;
+            float Y = frame.y + (j - 0.5) * frame.h;
+
+            // Fields outside the square the patch covers, unless filling all
+            bool inside = i >= frame.iStart && i < frame.iEnd && j >= frame.jStart && j < frame.jEnd;
+            Patch * neighbor = inside ? nullptr : FindPatch(patch -> level, X, Y);
+            if(neighbor){
+
+                // Same cell of a patch of this level
+                SimState * other = neighbor -> state;
+                Frame otherFrame = PatchFrame(neighbor);
+                int c = ((int)((X - otherFrame.x) / otherFrame.h) + 1) + (other -> GetNx() + 2) * ((int)((Y - otherFrame.y) / otherFrame.h) + 1);
+                state -> fields.dens[ind(i,j)] = other -> fields.dens[c];
+                state -> fields.temp[ind(i,j)] = other -> fields.temp[c];
+                state -> fields.xVel[ind(i,j)] = other -> fields.xVel[c];
+                state -> fields.yVel[ind(i,j)] = other -> fields.yVel[c];
+            }else if(interior || !inside){
+                state -> fields.dens[ind(i,j)] = Sample(parent -> fields.dens, pNx, pNy, parentFrame, X, Y);
+                state -> fields.temp[ind(i,j)] = Sample(parent -> fields.temp, pNx, pNy, parentFrame, X, Y);
+                state -> fields.xVel[ind(i,j)] = Sample(parent -> fields.xVel, pNx, pNy, parentFrame, X, Y);
+                state -> fields.yVel[ind(i,j)] = Sample(parent -> fields.yVel, pNx, pNy, parentFrame, X, Y);
+            }
+
+            // Sources everywhere, as they may move between steps
+            state -> fields.dens_source[ind(i,j)] = Sample(parent -> fields.dens_source, pNx, pNy, parentFrame, X, Y);
+            state -> fields.temp_source[ind(i,j)] = Sample(parent -> fields.temp_source, pNx, pNy, parentFrame, X, Y);
+            state -> fields.xVel_source[ind(i,j)] = Sample(parent -> fields.xVel_source, pNx, pNy, parentFrame, X, Y);
+            state -> fields.yVel_source[ind(i,j)] = Sample(parent -> fields.yVel_source, pNx, pNy, parentFrame, X, Y);
+        }
+    }
+    state -> InvalidateMixedFields();
+}
+
+// Interpolate both pressures of the parent of patch into every cell. Pressure is velocity
+// times length, the same on any cell size, so held ghost cells make the patch match its
+// parent at its edges, letting flow cross them as it does in the parent, and the rest
+// start its solve, leaving the sweeps only the detail of the finer cells
+void AMRState::FillPressureFromParent(Patch * patch)
+{
+    SimState * state = patch -> state;
+    SimState * parent = ParentState(patch);
+    Frame frame = PatchFrame(patch);
+    Frame parentFrame = ParentFrame(patch);
+    int Nx = state -> GetNx();
+    int Ny = state -> GetNy();
+    int pNx = parent -> GetNx();
+    int pNy = parent -> GetNy();
+
+    for(int j = 0; j <= Ny + 1; j++){
+        for(int i = 0; i <= Nx + 1; i++){
+            float X = frame.x + (i - 0.5) * frame.h;
+            float Y = frame.y + (j - 0.5) * frame.h;
+            state -> fields.pres[ind(i,j)] = Sample(parent -> fields.pres, pNx, pNy, parentFrame, X, Y);
+            state -> fields.pres_advect[ind(i,j)] = Sample(parent -> fields.pres_advect, pNx, pNy, parentFrame, X, Y);
+        }
+    }
+}
+
+// Average density and temperature of each two by two block of the square a patch covers
+// into the parent cell under it, so their totals over the square carry over as the
+// patch reached them. Velocity of the parent cell is the mean over its two faces across
+// each direction instead, each face the mean of the fine faces along it, halfway between
+// neighboring fine cells, so the parent sees the flow through its faces the patch reached
+void AMRState::RestrictToParent(Patch * patch)
+{
+    SimState * state = patch -> state;
+    SimState * parent = ParentState(patch);
+    Frame frame = PatchFrame(patch);
+    Frame parentFrame = ParentFrame(patch);
+    int pNx = parent -> GetNx();
+    int pNy = parent -> GetNy();
+    int Nx = state -> GetNx();
+    int Ny = state -> GetNy();
+
+    // First parent cell under the patch, and parent cells under it
+    int iParent = lround((frame.x + (frame.iStart - 1) * frame.h - parentFrame.x) / parentFrame.h) + 1;
+    int jParent = lround((frame.y + (frame.jStart - 1) * frame.h - parentFrame.y) / parentFrame.h) + 1;
+    int across = min((frame.iEnd - frame.iStart) / 2, pNx + 1 - iParent);
+    int up = min((frame.jEnd - frame.jStart) / 2, pNy + 1 - jParent);
+
+    float * d = state -> fields.dens;
+    float * T = state -> fields.temp;
+    float * u = state -> fields.xVel;
+    float * v = state -> fields.yVel;
+    for(int l = 0; l < up; l++){
+        for(int k = 0; k < across; k++){
+            int i = frame.iStart + 2 * k;
+            int j = frame.jStart + 2 * l;
+            int c = (iParent + k) + (pNx + 2) * (jParent + l);
+            parent -> fields.dens[c] = 0.25 * (d[ind(i,j)] + d[ind(i+1,j)] + d[ind(i,j+1)] + d[ind(i+1,j+1)]);
+            parent -> fields.temp[c] = 0.25 * (T[ind(i,j)] + T[ind(i+1,j)] + T[ind(i,j+1)] + T[ind(i+1,j+1)]);
+
+            // Mean of the faces on either side, each the mean of the fine faces along it,
+            // except next to walls of the base, whose mirrored ghost cells would halve
+            // velocity along the wall, where the cells under it are averaged instead
+            int di = i > 1 && i + 2 <= Nx ? 1 : 0;
+            int dj = j > 1 && j + 2 <= Ny ? 1 : 0;
+            float uSum = 0;
+            float vSum = 0;
+            for(int m = 0; m < 2; m++){
+                uSum += u[ind(i-di,j+m)] + u[ind(i,j+m)] + u[ind(i+1,j+m)] + u[ind(i+1+di,j+m)];
+                vSum += v[ind(i+m,j-dj)] + v[ind(i+m,j)] + v[ind(i+m,j+1)] + v[ind(i+m,j+1+dj)];
+            }
+            parent -> fields.xVel[c] = 0.125 * uSum;
+            parent -> fields.yVel[c] = 0.125 * vSum;
+        }
+    }
+    parent -> InvalidateMixedFields();
+}
+
+// Whether any interior cell in [iStart, iEnd) by [jStart, jEnd) holds more density than
+// amrDensity, changes density by more than amrGradient to its neighbors, or turns by more
+// than amrVorticity velocity across the cell; thresholds of zero are ignored
+bool AMRState::NeedsRefinement(SimState * state, int iStart, int iEnd, int jStart, int jEnd)
+{
+    const SimParams & params = base -> params;
+    int Nx = state -> GetNx();
+    float * d = state -> fields.dens;
+    float * u = state -> fields.xVel;
+    float * v = state -> fields.yVel;
+
+    for(int j = jStart; j < jEnd; j++){
+        for(int i = iStart; i < iEnd; i++){
+            if(params.amrDensity > 0 && d[ind(i,j)] > params.amrDensity){
+                return true;
+            }
+            if(params.amrGradient > 0){
+                float gradient = 0.5 * max(fabs(d[ind(i+1,j)] - d[ind(i-1,j)]), fabs(d[ind(i,j+1)] - d[ind(i,j-1)]));
+                if(gradient > params.amrGradient){
+                    return true;
+                }
+            }
+            if(params.amrVorticity > 0){
+                float vorticity = 0.5 * fabs(v[ind(i+1,j)] - v[ind(i-1,j)] - u[ind(i,j+1)] + u[ind(i,j-1)]);
+                if(vorticity > params.amrVorticity){
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Patch of level whose square covers point (X, Y), in base cells, if any
+AMRState::Patch * AMRState::FindPatch(int level, float X, float Y)
+{
+    float extent = PatchExtent(level);
+    if(X < 0 || Y < 0 || X >= base -> GetNx() || Y >= base -> GetNy()){
+        return nullptr;
+    }
+    return table[level - 1][(int)(X / extent) + PatchesAcross(level, base -> GetNx()) * (int)(Y / extent)];
+}
+
+// Parameters of a patch of level Nx cells across, matching cell size to the level
+SimParams AMRState::PatchParams(int level, int Nx)
+{
+    SimParams params = base -> params;
+    float cellSize = base -> params.lengthScale / base -> GetNx() * PatchExtent(level) / patchSize;
+    params.lengthScale = cellSize * Nx;
+    params.numThreads = 1;
+    params.hugePages = false;
+    params.amrLevels = 0;
+    params.activeRegion = false;
+
+    // Pressure solves start from the parent's, and diffusion from the undiffused field
+    // as when checking residuals, since finer cells take more sweeps to converge
+    params.warmStartPressure = true;
+    if(params.residualCheckInterval <= 0){
+        params.residualCheckInterval = 5;
+    }
+
+    // Held ghost cells bound relaxation sweeps and semi-Lagrangian advection only, so
+    // patches use those whatever the base uses
+    params.velocityAdvection = SimParams::semiLagrangian;
+    params.densityAdvection = SimParams::semiLagrangian;
+    params.temperatureAdvection = SimParams::semiLagrangian;
+    if(params.pressureSolver != SimParams::gaussSeidel){
+        params.pressureSolver = SimParams::redBlack;
+    }
+    if(params.diffusionSolver != SimParams::gaussSeidel){
+        params.diffusionSolver = SimParams::redBlack;
+    }
+    return params;
+}
+
+// Base cells across the square of a patch of level
+float AMRState::PatchExtent(int level)
+{
+    return ldexp(float(patchSize), -level);
+}
+
+// Patches of level needed to cover N base cells
+int AMRState::PatchesAcross(int level, int N)
+{
+    return (int)ceil(N / PatchExtent(level));
+}
+
+// Cells across the grid of a patch at x of level along N base cells, setting the square
+// it covers to cells [start, end). Buffers stop at walls of the base, as do squares
+// reaching past them, so the patch keeps those walls itself
+int AMRState::PatchCells(int level, int x, int N, int & start, int & end)
+{
+    float extent = PatchExtent(level);
+    float h = extent / patchSize;
+    start = x > 0 ? bufferSize + 1 : 1;
+    end = start + lround((min((x + 1) * extent, float(N)) - x * extent) / h);
+    return end - 1 + ((x + 1) * extent < N ? bufferSize : 0);
+}
+
+// Placement of patch, of its parent, and of the base
+AMRState::Frame AMRState::PatchFrame(Patch * patch)
+{
+    Frame frame;
+    float extent = PatchExtent(patch -> level);
+    frame.h = extent / patchSize;
+    PatchCells(patch -> level, patch -> x, base -> GetNx(), frame.iStart, frame.iEnd);
+    PatchCells(patch -> level, patch -> y, base -> GetNy(), frame.jStart, frame.jEnd);
+    frame.x = patch -> x * extent - (frame.iStart - 1) * frame.h;
+    frame.y = patch -> y * extent - (frame.jStart - 1) * frame.h;
+    return frame;
+}
+
+AMRState::Frame AMRState::ParentFrame(Patch * patch)
+{
+    return patch -> parent ? PatchFrame(patch -> parent) : BaseFrame();
+}
+
+AMRState::Frame AMRState::BaseFrame()
+{
+    return Frame{0, 0, 1, 1, 1, base -> GetNx() + 1, base -> GetNy() + 1};
+}
+
+SimState * AMRState::ParentState(Patch * patch)
+{
+    return patch -> parent ? patch -> parent -> state : base;
+}
+
+// Bilinear interpolation of field x of a grid placed by frame at domain point (X, Y),
+// held within the grid as departure points are in advection
+float AMRState::Sample(float * x, int Nx, int Ny, const Frame & frame, float X, float Y)
+{
+    float a = (X - frame.x) / frame.h + 0.5;
+    float b = (Y - frame.y) / frame.h + 0.5;
+    a = min(max(a, 0.5f), Nx + 0.5f);
+    b = min(max(b, 0.5f), Ny + 0.5f);
+
+    int i0 = (int)a;
+    int j0 = (int)b;
+    float s1 = a - i0;
+    float t1 = b - j0;
+    float s0 = 1 - s1;
+    float t0 = 1 - t1;
+
+    return s0 * (t0 * x[ind(i0,j0)] + t1 * x[ind(i0,j0+1)]) +
+           s1 * (t0 * x[ind(i0+1,j0)] + t1 * x[ind(i0+1,j0+1)]);
+}
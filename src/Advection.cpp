@@ -0,0 +1,328 @@
+/* Function definition file for semi-Lagrangian advection kernels */
+
+// Include header definitions
+#include "headers/Advection.h"
+#include "headers/Precision.h"
+
+// Vector intrinsics on x86 compilers supporting per-function targets
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ADVECTION_X86
+#include <immintrin.h>
+#endif
+
+// Macros
+#define ind(i,j) ((i) + (Nx + 2)*(j))
+
+
+
+// Departure point of cell (i, j) moving at velocity (u, v), as the lower left cell
+// of the four to interpolate from and the weights of the upper and right ones
+static inline void DeparturePoint(float u, float v, float dt0, int Nx, int Ny, int i, int j, int & i0, int & j0, float & s1, float & t1)
+{
+    // Calculate origin coordinates
+    float x = i - dt0 * u;
+    float y = j - dt0 * v;
+
+    // Discretize into adjacent grid elements
+    if(x <      0.5) { x =      0.5; }
+    if(x > Nx + 0.5) { x = Nx + 0.5; }
+    i0 = (int)x;
+
+    if(y <      0.5) { y =      0.5; }
+    if(y > Ny + 0.5) { y = Ny + 0.5; }
+    j0 = (int)y;
+
+    s1 = x - i0;
+    t1 = y - j0;
+}
+
+// Clamp value to range of the four samples interpolated from
+template<typename T>
+static inline T ClampToSamples(T x, T a, T b, T c, T d)
+{
+    T lo = a < b ? a : b;
+    T hi = a < b ? b : a;
+    if(c < lo) { lo = c; }
+    if(hi < c) { hi = c; }
+    if(d < lo) { lo = d; }
+    if(hi < d) { hi = d; }
+    return x < lo ? lo : (hi < x ? hi : x);
+}
+
+// Bilinear interpolation of each field at the departure point of cell (i, j)
+template<typename T>
+static inline void AdvectCell(T ** d, T ** d0, int count, float * u, float * v, float dt0, int Nx, int Ny, int i, int j)
+{
+    int i0, j0, i1, j1;
+    float s0, t0, s1, t1;
+
+    // Find departure point and its neighbors
+    DeparturePoint(u[ind(i,j)], v[ind(i,j)], dt0, Nx, Ny, i, j, i0, j0, s1, t1);
+    i1 = i0 + 1;
+    j1 = j0 + 1;
+    s0 = 1 - s1;
+    t0 = 1 - t1;
+
+    // Calculate new values due to advection
+    for(int f = 0; f < count; f++){
+        d[f][ind(i,j)] = s0 * (t0 * d0[f][ind(i0,j0)] + t1 * d0[f][ind(i0,j1)]) +
+                         s1 * (t0 * d0[f][ind(i1,j0)] + t1 * d0[f][ind(i1,j1)]);
+    }
+}
+
+// Portable kernel, one cell at a time
+template<typename T>
+void AdvectRowsScalar(T ** d, T ** d0, int count, float * u, float * v, float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd)
+{
+    for(int j = jStart; j < jEnd; j++){
+        for(int i = iStart; i < iEnd; i++){
+            AdvectCell(d, d0, count, u, v, dt0, Nx, Ny, i, j);
+        }
+    }
+}
+
+// Portable kernel for each field storage precision
+template void AdvectRowsScalar<float>(float **, float **, int, float *, float *, float, int, int, int, int, int, int);
+template void AdvectRowsScalar<double>(double **, double **, int, float *, float *, float, int, int, int, int, int, int);
+template void AdvectRowsScalar<Half>(Half **, Half **, int, float *, float *, float, int, int, int, int, int, int);
+template void AdvectRowsScalar<BFloat16>(BFloat16 **, BFloat16 **, int, float *, float *, float, int, int, int, int, int, int);
+
+// Ensemble kernel, one cell at a time with each lane following its own velocity;
+// departure points and weights are computed for all lanes together, and samples
+// gathered lane by lane
+template<int K>
+void AdvectRowsLanes(Lanes<float, K> ** d, Lanes<float, K> ** d0, int count, Lanes<float, K> * u, Lanes<float, K> * v,
+                     float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd)
+{
+    for(int j = jStart; j < jEnd; j++){
+        for(int i = iStart; i < iEnd; i++){
+            int i0[K], j0[K];
+            float s0[K], t0[K], s1[K], t1[K];
+
+            // Calculate origin coordinates and weights in each lane
+            for(int k = 0; k < K; k++){
+                DeparturePoint(u[ind(i,j)].v[k], v[ind(i,j)].v[k], dt0, Nx, Ny, i, j, i0[k], j0[k], s1[k], t1[k]);
+                s0[k] = 1 - s1[k];
+                t0[k] = 1 - t1[k];
+            }
+
+            // Calculate new values due to advection
+            for(int f = 0; f < count; f++){
+                for(int k = 0; k < K; k++){
+                    int c = ind(i0[k],j0[k]);
+                    d[f][ind(i,j)].v[k] = s0[k] * (t0[k] * d0[f][c].v[k] + t1[k] * d0[f][c + Nx + 2].v[k]) +
+                                          s1[k] * (t0[k] * d0[f][c + 1].v[k] + t1[k] * d0[f][c + Nx + 3].v[k]);
+                }
+            }
+        }
+    }
+}
+
+// Ensemble kernel for each lane count
+template void AdvectRowsLanes<4>(Lanes<float, 4> **, Lanes<float, 4> **, int, Lanes<float, 4> *, Lanes<float, 4> *, float, int, int, int, int, int, int);
+template void AdvectRowsLanes<8>(Lanes<float, 8> **, Lanes<float, 8> **, int, Lanes<float, 8> *, Lanes<float, 8> *, float, int, int, int, int, int, int);
+template void AdvectRowsLanes<16>(Lanes<float, 16> **, Lanes<float, 16> **, int, Lanes<float, 16> *, Lanes<float, 16> *, float, int, int, int, int, int, int);
+
+// Limiter for higher order schemes, clamping each cell to the samples its departure point
+// interpolates from, so no new extrema appear
+template<typename T>
+void ClampRowsScalar(T ** d, T ** d0, int count, float * u, float * v, float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd)
+{
+    for(int j = jStart; j < jEnd; j++){
+        for(int i = iStart; i < iEnd; i++){
+            int i0, j0;
+            float s1, t1;
+            DeparturePoint(u[ind(i,j)], v[ind(i,j)], dt0, Nx, Ny, i, j, i0, j0, s1, t1);
+            int c = ind(i0,j0);
+            for(int f = 0; f < count; f++){
+                d[f][ind(i,j)] = ClampToSamples(d[f][ind(i,j)], d0[f][c], d0[f][c + 1], d0[f][c + Nx + 2], d0[f][c + Nx + 3]);
+            }
+        }
+    }
+}
+
+// Limiter for each field storage precision
+template void ClampRowsScalar<float>(float **, float **, int, float *, float *, float, int, int, int, int, int, int);
+template void ClampRowsScalar<double>(double **, double **, int, float *, float *, float, int, int, int, int, int, int);
+template void ClampRowsScalar<Half>(Half **, Half **, int, float *, float *, float, int, int, int, int, int, int);
+template void ClampRowsScalar<BFloat16>(BFloat16 **, BFloat16 **, int, float *, float *, float, int, int, int, int, int, int);
+
+// Ensemble limiter, clamping each lane to the samples of its own departure point
+template<int K>
+void ClampRowsLanes(Lanes<float, K> ** d, Lanes<float, K> ** d0, int count, Lanes<float, K> * u, Lanes<float, K> * v,
+                    float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd)
+{
+    for(int j = jStart; j < jEnd; j++){
+        for(int i = iStart; i < iEnd; i++){
+            for(int k = 0; k < K; k++){
+                int i0, j0;
+                float s1, t1;
+                DeparturePoint(u[ind(i,j)].v[k], v[ind(i,j)].v[k], dt0, Nx, Ny, i, j, i0, j0, s1, t1);
+                int c = ind(i0,j0);
+                for(int f = 0; f < count; f++){
+                    d[f][ind(i,j)].v[k] = ClampToSamples(d[f][ind(i,j)].v[k], d0[f][c].v[k], d0[f][c + 1].v[k],
+                                                         d0[f][c + Nx + 2].v[k], d0[f][c + Nx + 3].v[k]);
+                }
+            }
+        }
+    }
+}
+
+// Ensemble limiter for each lane count
+template void ClampRowsLanes<4>(Lanes<float, 4> **, Lanes<float, 4> **, int, Lanes<float, 4> *, Lanes<float, 4> *, float, int, int, int, int, int, int);
+template void ClampRowsLanes<8>(Lanes<float, 8> **, Lanes<float, 8> **, int, Lanes<float, 8> *, Lanes<float, 8> *, float, int, int, int, int, int, int);
+template void ClampRowsLanes<16>(Lanes<float, 16> **, Lanes<float, 16> **, int, Lanes<float, 16> *, Lanes<float, 16> *, float, int, int, int, int, int, int);
+
+#ifdef ADVECTION_X86
+
+// Eight cells per iteration, sampling with hardware gathers
+__attribute__((target("avx2")))
+void AdvectRowsAVX2(float ** d, float ** d0, int count, float * u, float * v, float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd)
+{
+    const __m256 dt0v = _mm256_set1_ps(dt0);
+    const __m256 lower = _mm256_set1_ps(0.5);
+    const __m256 xUpper = _mm256_set1_ps(Nx + 0.5);
+    const __m256 yUpper = _mm256_set1_ps(Ny + 0.5);
+    const __m256 one = _mm256_set1_ps(1);
+    const __m256 lanes = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i stride = _mm256_set1_epi32(Nx + 2);
+    const __m256i next = _mm256_set1_epi32(1);
+
+    for(int j = jStart; j < jEnd; j++){
+        const __m256 row = _mm256_set1_ps(j);
+        int i = iStart;
+        for(; i + 8 <= iEnd; i += 8){
+
+            // Calculate origin coordinates, clamped inside the ghost layer
+            __m256 x = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps(i), lanes),
+                                     _mm256_mul_ps(dt0v, _mm256_loadu_ps(u + ind(i,j))));
+            __m256 y = _mm256_sub_ps(row, _mm256_mul_ps(dt0v, _mm256_loadu_ps(v + ind(i,j))));
+            x = _mm256_min_ps(_mm256_max_ps(x, lower), xUpper);
+            y = _mm256_min_ps(_mm256_max_ps(y, lower), yUpper);
+
+            // Coordinates are positive, so truncation floors
+            __m256i i0 = _mm256_cvttps_epi32(x);
+            __m256i j0 = _mm256_cvttps_epi32(y);
+            __m256 s1 = _mm256_sub_ps(x, _mm256_cvtepi32_ps(i0));
+            __m256 t1 = _mm256_sub_ps(y, _mm256_cvtepi32_ps(j0));
+            __m256 s0 = _mm256_sub_ps(one, s1);
+            __m256 t0 = _mm256_sub_ps(one, t1);
+
+            // Indices of the four surrounding samples
+            __m256i k00 = _mm256_add_epi32(i0, _mm256_mullo_epi32(j0, stride));
+            __m256i k01 = _mm256_add_epi32(k00, stride);
+            __m256i k10 = _mm256_add_epi32(k00, next);
+            __m256i k11 = _mm256_add_epi32(k01, next);
+
+            // Gather and interpolate each field with the shared weights
+            for(int f = 0; f < count; f++){
+                __m256 d00 = _mm256_i32gather_ps(d0[f], k00, 4);
+                __m256 d01 = _mm256_i32gather_ps(d0[f], k01, 4);
+                __m256 d10 = _mm256_i32gather_ps(d0[f], k10, 4);
+                __m256 d11 = _mm256_i32gather_ps(d0[f], k11, 4);
+
+                __m256 left = _mm256_add_ps(_mm256_mul_ps(t0, d00), _mm256_mul_ps(t1, d01));
+                __m256 right = _mm256_add_ps(_mm256_mul_ps(t0, d10), _mm256_mul_ps(t1, d11));
+                _mm256_storeu_ps(d[f] + ind(i,j), _mm256_add_ps(_mm256_mul_ps(s0, left), _mm256_mul_ps(s1, right)));
+            }
+        }
+
+        // Finish row one cell at a time
+        for(; i < iEnd; i++){
+            AdvectCell(d, d0, count, u, v, dt0, Nx, Ny, i, j);
+        }
+    }
+}
+
+// Sixteen cells per iteration, sampling with hardware gathers
+__attribute__((target("avx512f")))
+void AdvectRowsAVX512(float ** d, float ** d0, int count, float * u, float * v, float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd)
+{
+    const __m512 dt0v = _mm512_set1_ps(dt0);
+    const __m512 lower = _mm512_set1_ps(0.5);
+    const __m512 xUpper = _mm512_set1_ps(Nx + 0.5);
+    const __m512 yUpper = _mm512_set1_ps(Ny + 0.5);
+    const __m512 one = _mm512_set1_ps(1);
+    const __m512 lanes = _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i stride = _mm512_set1_epi32(Nx + 2);
+    const __m512i next = _mm512_set1_epi32(1);
+
+    for(int j = jStart; j < jEnd; j++){
+        const __m512 row = _mm512_set1_ps(j);
+        int i = iStart;
+        for(; i + 16 <= iEnd; i += 16){
+
+            // Calculate origin coordinates, clamped inside the ghost layer
+            __m512 x = _mm512_sub_ps(_mm512_add_ps(_mm512_set1_ps(i), lanes),
+                                     _mm512_mul_ps(dt0v, _mm512_loadu_ps(u + ind(i,j))));
+            __m512 y = _mm512_sub_ps(row, _mm512_mul_ps(dt0v, _mm512_loadu_ps(v + ind(i,j))));
+            x = _mm512_min_ps(_mm512_max_ps(x, lower), xUpper);
+            y = _mm512_min_ps(_mm512_max_ps(y, lower), yUpper);
+
+            // Coordinates are positive, so truncation floors
+            __m512i i0 = _mm512_cvttps_epi32(x);
+            __m512i j0 = _mm512_cvttps_epi32(y);
+            __m512 s1 = _mm512_sub_ps(x, _mm512_cvtepi32_ps(i0));
+            __m512 t1 = _mm512_sub_ps(y, _mm512_cvtepi32_ps(j0));
+            __m512 s0 = _mm512_sub_ps(one, s1);
+            __m512 t0 = _mm512_sub_ps(one, t1);
+
+            // Indices of the four surrounding samples
+            __m512i k00 = _mm512_add_epi32(i0, _mm512_mullo_epi32(j0, stride));
+            __m512i k01 = _mm512_add_epi32(k00, stride);
+            __m512i k10 = _mm512_add_epi32(k00, next);
+            __m512i k11 = _mm512_add_epi32(k01, next);
+
+            // Gather and interpolate each field with the shared weights
+            for(int f = 0; f < count; f++){
+                __m512 d00 = _mm512_i32gather_ps(k00, d0[f], 4);
+                __m512 d01 = _mm512_i32gather_ps(k01, d0[f], 4);
+                __m512 d10 = _mm512_i32gather_ps(k10, d0[f], 4);
+                __m512 d11 = _mm512_i32gather_ps(k11, d0[f], 4);
+
+                __m512 left = _mm512_add_ps(_mm512_mul_ps(t0, d00), _mm512_mul_ps(t1, d01));
+                __m512 right = _mm512_add_ps(_mm512_mul_ps(t0, d10), _mm512_mul_ps(t1, d11));
+                _mm512_storeu_ps(d[f] + ind(i,j), _mm512_add_ps(_mm512_mul_ps(s0, left), _mm512_mul_ps(s1, right)));
+            }
+        }
+
+        // Finish row one cell at a time
+        for(; i < iEnd; i++){
+            AdvectCell(d, d0, count, u, v, dt0, Nx, Ny, i, j);
+        }
+    }
+}
+
+// Fastest kernel supported by this CPU
+AdvectRowsKernel SelectAdvectRows()
+{
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")){
+        return AdvectRowsAVX512;
+    }
+    if(__builtin_cpu_supports("avx2")){
+        return AdvectRowsAVX2;
+    }
+    return AdvectRowsScalar<float>;
+}
+
+#else
+
+// Vector kernels fall back to scalar on other targets
+void AdvectRowsAVX2(float ** d, float ** d0, int count, float * u, float * v, float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd)
+{
+    AdvectRowsScalar(d, d0, count, u, v, dt0, Nx, Ny, iStart, iEnd, jStart, jEnd);
+}
+
+void AdvectRowsAVX512(float ** d, float ** d0, int count, float * u, float * v, float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd)
+{
+    AdvectRowsScalar(d, d0, count, u, v, dt0, Nx, Ny, iStart, iEnd, jStart, jEnd);
+}
+
+// Fastest kernel supported by this CPU
+AdvectRowsKernel SelectAdvectRows()
+{
+    return AdvectRowsScalar<float>;
+}
+
+#endif
@@ -0,0 +1,232 @@
+/* Function definition file for sparse grids stored in bricks */
+
+// Include header definitions
+#include "headers/BrickGrid.h"
+
+// Includes and usings
+#include <cmath>
+using namespace std;
+
+// Macros
+#define B BrickGrid::brickSize
+
+
+
+//// PUBLIC METHODS ////
+
+// Constructor, starting with no bricks allocated
+BrickGrid::BrickGrid(int Nx, int Ny, const std::vector<float> & background)
+{
+    this -> Nx = Nx;
+    this -> Ny = Ny;
+    this -> bricksX = (Nx + B - 1) / B;
+    this -> bricksY = (Ny + B - 1) / B;
+    this -> numPlanes = background.size();
+    this -> background = background;
+
+    walls.assign(numPlanes, noWalls);
+    table.assign(bricksX * bricksY, -1);
+}
+
+// Slot of brick (bi, bj), or -1 if unallocated
+int BrickGrid::Lookup(int bi, int bj)
+{
+    return table[bi + bricksX * bj];
+}
+
+// Slot of brick (bi, bj), allocating it filled with background if missing
+int BrickGrid::Activate(int bi, int bj)
+{
+    int & entry = table[bi + bricksX * bj];
+    if(entry >= 0){
+        return entry;
+    }
+
+    // Reuse a released slot, or grow the pool by one
+    int slot;
+    if(!freeSlots.empty()){
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }else{
+        slot = slotBrick.size();
+        slotBrick.push_back(-1);
+        activeIndex.push_back(-1);
+        pool.resize(pool.size() + numPlanes * B * B);
+    }
+
+    for(int plane = 0; plane < numPlanes; plane++){
+        float * cells = Cells(plane, slot);
+        for(int c = 0; c < B * B; c++){
+            cells[c] = background[plane];
+        }
+    }
+
+    entry = slot;
+    slotBrick[slot] = bi + bricksX * bj;
+    activeIndex[slot] = active.size();
+    active.push_back(slot);
+    return slot;
+}
+
+// Free brick of slot, so its cells read as background again
+void BrickGrid::Release(int slot)
+{
+    table[slotBrick[slot]] = -1;
+
+    // Move last active slot into the place of this one
+    int last = active.back();
+    active[activeIndex[slot]] = last;
+    activeIndex[last] = activeIndex[slot];
+    active.pop_back();
+
+    activeIndex[slot] = -1;
+    freeSlots.push_back(slot);
+}
+
+// Slots of allocated bricks
+const std::vector<int> & BrickGrid::ActiveBricks()
+{
+    return active;
+}
+
+// Brick position of slot
+int BrickGrid::BrickX(int slot) { return slotBrick[slot] % bricksX; }
+int BrickGrid::BrickY(int slot) { return slotBrick[slot] / bricksX; }
+
+// Cells of one plane of slot, row by row
+float * BrickGrid::Cells(int plane, int slot)
+{
+    return pool.data() + (size_t(slot) * numPlanes + plane) * B * B;
+}
+
+// Value of interior cell (i, j)
+float BrickGrid::Get(int plane, int i, int j)
+{
+    if(i < 1 || i > Nx || j < 1 || j > Ny){
+        return Ghost(plane, i, j);
+    }
+    int slot = table[(i - 1) / B + bricksX * ((j - 1) / B)];
+    if(slot < 0){
+        return background[plane];
+    }
+    return Cells(plane, slot)[(i - 1) % B + B * ((j - 1) % B)];
+}
+
+// Set interior cell (i, j), allocating its brick if needed
+void BrickGrid::Set(int plane, int i, int j, float value)
+{
+    if(i < 1 || i > Nx || j < 1 || j > Ny){
+        return;
+    }
+    int slot = Activate((i - 1) / B, (j - 1) / B);
+    Cells(plane, slot)[(i - 1) % B + B * ((j - 1) % B)] = value;
+}
+
+// Bilinear interpolation at point (x, y), in cell coordinates
+float BrickGrid::Sample(int plane, float x, float y)
+{
+    int i0 = (int)floor(x);
+    int j0 = (int)floor(y);
+    float s1 = x - i0;
+    float t1 = y - j0;
+    float s0 = 1 - s1;
+    float t0 = 1 - t1;
+
+    // Read all four cells from one brick when they share it
+    int li = (i0 - 1) % B;
+    int lj = (j0 - 1) % B;
+    if(i0 >= 1 && j0 >= 1 && i0 < Nx && j0 < Ny && li < B - 1 && lj < B - 1){
+        int slot = table[(i0 - 1) / B + bricksX * ((j0 - 1) / B)];
+        if(slot < 0){
+            return background[plane];
+        }
+        float * c = Cells(plane, slot) + li + B * lj;
+        return s0 * (t0 * c[0] + t1 * c[B]) + s1 * (t0 * c[1] + t1 * c[B + 1]);
+    }
+
+    return s0 * (t0 * Get(plane, i0,     j0) + t1 * Get(plane, i0,     j0 + 1)) +
+           s1 * (t0 * Get(plane, i0 + 1, j0) + t1 * Get(plane, i0 + 1, j0 + 1));
+}
+
+// Copy cells of slot with a ring of neighboring cells into halo, haloSize cells square,
+// so stencils near brick edges read neighbors without looking up their bricks
+void BrickGrid::GatherHalo(int plane, int slot, float * halo)
+{
+    float * cells = Cells(plane, slot);
+    int i0 = BrickX(slot) * B;
+    int j0 = BrickY(slot) * B;
+
+    // Cells of the brick itself
+    for(int lj = 0; lj < B; lj++){
+        for(int li = 0; li < B; li++){
+            halo[(li + 1) + haloSize * (lj + 1)] = cells[li + B * lj];
+        }
+    }
+
+    // Cells of a brick reaching past the edge of the grid, which are ghost cells or
+    // background rather than what the brick holds there
+    int iCount = min(B, Nx - i0);
+    int jCount = min(B, Ny - j0);
+    if(iCount < B || jCount < B){
+        for(int lj = 0; lj < B; lj++){
+            for(int li = lj < jCount ? iCount : 0; li < B; li++){
+                halo[(li + 1) + haloSize * (lj + 1)] = Get(plane, i0 + li + 1, j0 + lj + 1);
+            }
+        }
+    }
+
+    // Rows below and above, then columns either side
+    for(int li = -1; li <= B; li++){
+        halo[(li + 1)                      ] = Get(plane, i0 + li + 1, j0);
+        halo[(li + 1) + haloSize * (B + 1)] = Get(plane, i0 + li + 1, j0 + B + 1);
+    }
+    for(int lj = 0; lj < B; lj++){
+        halo[        haloSize * (lj + 1)] = Get(plane, i0,         j0 + lj + 1);
+        halo[B + 1 + haloSize * (lj + 1)] = Get(plane, i0 + B + 1, j0 + lj + 1);
+    }
+}
+
+// Value of plane where no brick is allocated
+float BrickGrid::GetBackground(int plane) { return background[plane]; }
+void BrickGrid::SetBackground(int plane, float value) { background[plane] = value; }
+
+// Boundary conditions of plane at the walls
+void BrickGrid::SetWalls(int plane, int b) { walls[plane] = b; }
+
+// Grid size accessors
+int BrickGrid::GetNx() { return Nx; }
+int BrickGrid::GetNy() { return Ny; }
+int BrickGrid::GetBricksX() { return bricksX; }
+int BrickGrid::GetBricksY() { return bricksY; }
+
+// Bytes held by the brick table and pool
+size_t BrickGrid::GetMemory()
+{
+    return pool.capacity() * sizeof(float) + (table.capacity() + slotBrick.capacity() +
+           activeIndex.capacity() + active.capacity() + freeSlots.capacity()) * sizeof(int);
+}
+
+
+//// PRIVATE METHODS ////
+
+// Value of cell (i, j) outside the interior, reflected across the walls from the
+// neighboring interior cell as SetBoundary would, with corners averaging their
+// neighbors, or background without walls or beyond the ghost cells
+float BrickGrid::Ghost(int plane, int i, int j)
+{
+    int b = walls[plane];
+    if(b == noWalls || i < 0 || i > Nx + 1 || j < 0 || j > Ny + 1){
+        return background[plane];
+    }
+
+    // Reflection factors across vertical and horizontal walls
+    const float xMod = b == -1 ? 0. : (b == 1 ? -1. : 1.);
+    const float yMod = b == -1 ? 0. : (b == 2 ? -1. : 1.);
+
+    int iIn = min(max(i, 1), Nx);
+    int jIn = min(max(j, 1), Ny);
+    if(i != iIn && j != jIn){
+        return 0.5 * (Ghost(plane, iIn, j) + Ghost(plane, i, jIn));
+    }
+    return i != iIn ? xMod * Get(plane, iIn, j) : yMod * Get(plane, i, jIn);
+}
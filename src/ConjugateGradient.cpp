@@ -0,0 +1,215 @@
+/* Function definition file for preconditioned conjugate gradient solver */
+
+// Include header definitions
+#include "headers/ConjugateGradient.h"
+#include "headers/SimState.h"
+
+// Includes and usings
+#include <cmath>
+using namespace std;
+
+// Macros
+#define ind(i,j) ((i) + (Nx + 2)*(j))
+
+
+
+//// PUBLIC METHODS ////
+
+// Constructor
+ConjugateGradient::ConjugateGradient(int Nx, int Ny, ThreadPool* threadPool)
+{
+    this -> Nx = Nx;
+    this -> Ny = Ny;
+    this -> size = (Nx + 2) * (Ny + 2);
+    this -> threadPool = threadPool;
+    lastResidual = 0;
+
+    // Initialize work arrays
+    r           = new float[size]();
+    z           = new float[size]();
+    d           = new float[size]();
+    q           = new float[size]();
+    shift       = new float[size]();
+    rhs         = new float[size]();
+    rowSums     = new double[Ny + 2]();
+    rowSumsAlt  = new double[Ny + 2]();
+}
+
+// Destructor
+ConjugateGradient::~ConjugateGradient()
+{
+    delete[] r;
+    delete[] z;
+    delete[] d;
+    delete[] q;
+    delete[] shift;
+    delete[] rhs;
+    delete[] rowSums;
+    delete[] rowSumsAlt;
+}
+
+// Solve until residual falls below tolerance relative to rhs, with x as initial guess
+int ConjugateGradient::Solve(int b, float * x, float * rhs, float * shift, float tolerance, int maxIterations)
+{
+    // Pure Neumann system only admits a zero-mean source
+    if(shift == nullptr){
+        RemoveMean(rhs);
+    }
+
+    // Trivial solution for empty source
+    double rhsNorm = sqrt(Dot(rhs, rhs));
+    if(rhsNorm == 0.0){
+        for(int i = 0; i < size; i++){
+            x[i] = 0;
+        }
+        lastResidual = 0;
+        return 0;
+    }
+
+    // Initial residual, preconditioned residual, and search direction
+    ApplyOperator(b, x, q, shift);
+    threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            double rz = 0, rr = 0;
+            for(int i = 1; i <= Nx; i++){
+                float diag = shift ? 4 + shift[ind(i,j)] : 4;
+                r[ind(i,j)] = rhs[ind(i,j)] - q[ind(i,j)];
+                z[ind(i,j)] = r[ind(i,j)] / diag;
+                d[ind(i,j)] = z[ind(i,j)];
+                rz += r[ind(i,j)] * z[ind(i,j)];
+                rr += r[ind(i,j)] * r[ind(i,j)];
+            }
+            rowSums[j] = rz;
+            rowSumsAlt[j] = rr;
+        }
+    });
+    double rz = SumRows(rowSums);
+    double rr = SumRows(rowSumsAlt);
+
+    // Iterate until converged
+    int k = 0;
+    while(k < maxIterations && sqrt(rr) > tolerance * rhsNorm){
+
+        // Step length along search direction
+        double dq = ApplyOperator(b, d, q, shift);
+        if(dq <= 0.0){
+            break;
+        }
+        float alpha = rz / dq;
+
+        // Update solution and residuals
+        threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+            for(int j = jStart; j < jEnd; j++){
+                double rz = 0, rr = 0;
+                for(int i = 1; i <= Nx; i++){
+                    float diag = shift ? 4 + shift[ind(i,j)] : 4;
+                    x[ind(i,j)] += alpha * d[ind(i,j)];
+                    r[ind(i,j)] -= alpha * q[ind(i,j)];
+                    z[ind(i,j)] = r[ind(i,j)] / diag;
+                    rz += r[ind(i,j)] * z[ind(i,j)];
+                    rr += r[ind(i,j)] * r[ind(i,j)];
+                }
+                rowSums[j] = rz;
+                rowSumsAlt[j] = rr;
+            }
+        });
+        double rzNew = SumRows(rowSums);
+        rr = SumRows(rowSumsAlt);
+
+        // Conjugate next search direction
+        float beta = rzNew / rz;
+        rz = rzNew;
+        threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+            for(int j = jStart; j < jEnd; j++){
+                for(int i = 1; i <= Nx; i++){
+                    d[ind(i,j)] = z[ind(i,j)] + beta * d[ind(i,j)];
+                }
+            }
+        });
+        k++;
+    }
+
+    // Fill ghost cells of solution
+    SimState::SetBoundary(b, x, Nx, Ny);
+
+    lastResidual = sqrt(rr) / rhsNorm;
+    return k;
+}
+
+// Scratch array accessors
+float * ConjugateGradient::Shift() { return shift; }
+float * ConjugateGradient::Rhs() { return rhs; }
+
+// Property accessors
+int ConjugateGradient::GetNx() { return Nx; }
+int ConjugateGradient::GetNy() { return Ny; }
+float ConjugateGradient::LastResidual() { return lastResidual; }
+
+
+//// PRIVATE METHODS ////
+
+// Apply system matrix to x, returning dot product of x and result
+double ConjugateGradient::ApplyOperator(int b, float * x, float * Ax, float * shift)
+{
+    // Ghost cells follow the same rule as the relaxation solvers
+    SimState::SetBoundary(b, x, Nx, Ny);
+
+    threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            double xAx = 0;
+            for(int i = 1; i <= Nx; i++){
+                float diag = shift ? 4 + shift[ind(i,j)] : 4;
+                Ax[ind(i,j)] = diag * x[ind(i,j)] - x[ind(i-1,j)] - x[ind(i+1,j)] -
+                                                    x[ind(i,j-1)] - x[ind(i,j+1)];
+                xAx += x[ind(i,j)] * Ax[ind(i,j)];
+            }
+            rowSums[j] = xAx;
+        }
+    });
+
+    return SumRows(rowSums);
+}
+
+// Dot product over interior cells
+double ConjugateGradient::Dot(float * x, float * y)
+{
+    threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            double sum = 0;
+            for(int i = 1; i <= Nx; i++){
+                sum += x[ind(i,j)] * y[ind(i,j)];
+            }
+            rowSums[j] = sum;
+        }
+    });
+
+    return SumRows(rowSums);
+}
+
+// Add per-row partial sums in a fixed order
+double ConjugateGradient::SumRows(double * sums)
+{
+    double sum = 0;
+    for(int j = 1; j <= Ny; j++){
+        sum += sums[j];
+    }
+    return sum;
+}
+
+// Subtract average over interior cells
+void ConjugateGradient::RemoveMean(float * x)
+{
+    double sum = 0;
+    for(int j = 1; j <= Ny; j++){
+        for(int i = 1; i <= Nx; i++){
+            sum += x[ind(i,j)];
+        }
+    }
+    float mean = sum / (Nx * Ny);
+
+    for(int j = 1; j <= Ny; j++){
+        for(int i = 1; i <= Nx; i++){
+            x[ind(i,j)] -= mean;
+        }
+    }
+}
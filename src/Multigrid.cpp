@@ -0,0 +1,330 @@
+/* Function definition file for geometric multigrid pressure solver */
+
+// Include header definitions
+#include "headers/Multigrid.h"
+#include "headers/SimState.h"
+
+// Includes and usings
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+// Macros
+#define ind(i,j) ((i) + (Nx + 2)*(j))
+
+// Cycle settings
+static const int preSweeps = 2;
+static const int postSweeps = 2;
+static const int coarseSweeps = 40;
+static const int coarsestN = 4;
+
+
+
+//// PUBLIC METHODS ////
+
+// Constructor, building levels down to a few cells across
+Multigrid::Multigrid(int Nx, int Ny, ThreadPool* threadPool)
+{
+    this -> threadPool = threadPool;
+    lastResidual = -1;
+
+    // Finest level borrows caller arrays during each solve
+    int size = (Nx + 2) * (Ny + 2);
+    levels.push_back({ Nx, Ny, nullptr, nullptr, new float[size]() });
+
+    // Halve grid until coarse enough to solve by relaxation alone, keeping
+    // cells square so the same stencil applies on every level
+    while(Nx > coarsestN && Ny > coarsestN){
+        Nx = (Nx + 1) / 2;
+        Ny = (Ny + 1) / 2;
+        size = (Nx + 2) * (Ny + 2);
+        levels.push_back({ Nx, Ny, new float[size](), new float[size](), new float[size]() });
+    }
+}
+
+// Destructor
+Multigrid::~Multigrid()
+{
+    for(int l = 0; l < int(levels.size()); l++){
+        if(l > 0){
+            delete[] levels[l].x;
+            delete[] levels[l].rhs;
+        }
+        delete[] levels[l].res;
+    }
+}
+
+// Solve 4p - (sum of neighbors) = div, with p used as initial guess,
+// stopping early once residual is below tolerance (if positive)
+int Multigrid::Solve(float * p, float * div, int maxCycles, float tolerance, bool fullMultigrid)
+{
+    // Point finest level at caller arrays
+    levels[0].x = p;
+    levels[0].rhs = div;
+
+    // Neumann boundaries only admit a zero-mean source
+    RemoveMean(0, div);
+    double rhsNorm = tolerance > 0 ? Norm(0, div) : 0;
+    lastResidual = -1;
+    int cycles = 0;
+
+    // Full multigrid: solve coarse problems first for the initial guess
+    if(fullMultigrid){
+        int last = levels.size() - 1;
+        for(int l = 0; l < last; l++){
+            Restrict(l, levels[l].rhs, levels[l + 1].rhs);
+        }
+
+        Clear(last, levels[last].x);
+        Smooth(last, CoarseSweeps());
+
+        for(int l = last - 1; l >= 0; l--){
+            Prolong(l + 1, levels[l + 1].x, levels[l].x, false);
+            VCycle(l);
+        }
+        cycles++;
+    }
+
+    // Remaining cycles refine finest solution
+    while(true){
+
+        // Measure residual after each cycle and stop once converged
+        if(tolerance > 0){
+            ComputeResidual(0);
+            double resNorm = Norm(0, levels[0].res);
+            lastResidual = rhsNorm > 0 ? resNorm / rhsNorm : resNorm;
+            if(lastResidual <= tolerance){
+                break;
+            }
+        }
+
+        if(cycles >= maxCycles){
+            break;
+        }
+        VCycle(0);
+        cycles++;
+    }
+
+    // Release caller arrays
+    levels[0].x = nullptr;
+    levels[0].rhs = nullptr;
+
+    return cycles;
+}
+
+// Get finest grid size
+int Multigrid::GetNx()
+{
+    return levels[0].Nx;
+}
+
+int Multigrid::GetNy()
+{
+    return levels[0].Ny;
+}
+
+// Get number of levels in hierarchy
+int Multigrid::GetLevels()
+{
+    return levels.size();
+}
+
+// Get relative residual of last solve, or -1 if not measured
+float Multigrid::LastResidual()
+{
+    return lastResidual;
+}
+
+
+//// PRIVATE METHODS ////
+
+// Recursive V-cycle correcting solution at level
+void Multigrid::VCycle(int level)
+{
+    Level & fine = levels[level];
+
+    // Relax coarsest level to convergence
+    if(level == int(levels.size()) - 1){
+        RemoveMean(level, fine.rhs);
+        Smooth(level, CoarseSweeps());
+        return;
+    }
+    Level & coarse = levels[level + 1];
+
+    // Damp high-frequency error
+    Smooth(level, preSweeps);
+
+    // Solve for correction on coarse grid
+    ComputeResidual(level);
+    Restrict(level, fine.res, coarse.rhs);
+    Clear(level + 1, coarse.x);
+    VCycle(level + 1);
+
+    // Apply correction and smooth again
+    Prolong(level + 1, coarse.x, fine.x, true);
+    Smooth(level, postSweeps);
+}
+
+// Red-black Gauss-Seidel relaxation at level
+void Multigrid::Smooth(int level, int sweeps)
+{
+    int Nx = levels[level].Nx;
+    int Ny = levels[level].Ny;
+    float * x = levels[level].x;
+    float * rhs = levels[level].rhs;
+
+    // Ghost cells of each row are refreshed once its second color is done
+    for(int k = 0; k < sweeps; k++){
+        for(int color = 0; color < 2; color++){
+            threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+                for(int j = jStart; j < jEnd; j++){
+                    for(int i = 1 + (j + color + 1) % 2; i <= Nx; i += 2){
+                        x[ind(i,j)] = (rhs[ind(i,j)] + x[ind(i-1,j)] + x[ind(i+1,j)] +
+                                                       x[ind(i,j-1)] + x[ind(i,j+1)])/4;
+                    }
+                    if(color == 1){
+                        SimState::SetRowBoundary<0>(x, Nx, Ny, {1, Nx + 1, 1, Ny + 1}, j);
+                    }
+                }
+            });
+        }
+    }
+    if(sweeps > 0){
+        SimState::SetCorners(x, Nx, Ny);
+    }
+}
+
+// Calculate residual of current solution at level
+void Multigrid::ComputeResidual(int level)
+{
+    int Nx = levels[level].Nx;
+    int Ny = levels[level].Ny;
+    float * x = levels[level].x;
+    float * rhs = levels[level].rhs;
+    float * res = levels[level].res;
+
+    threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            for(int i = 1; i <= Nx; i++){
+                res[ind(i,j)] = rhs[ind(i,j)] - 4 * x[ind(i,j)] + x[ind(i-1,j)] + x[ind(i+1,j)] +
+                                                                  x[ind(i,j-1)] + x[ind(i,j+1)];
+            }
+        }
+    });
+}
+
+// Transfer fine field to coarse grid, scaled for doubled cell size
+void Multigrid::Restrict(int fineLevel, float * fine, float * coarse)
+{
+    int Nxf = levels[fineLevel].Nx;
+    int Nyf = levels[fineLevel].Ny;
+    int Nx = levels[fineLevel + 1].Nx;
+    int Ny = levels[fineLevel + 1].Ny;
+
+    threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+        for(int J = jStart; J < jEnd; J++){
+            for(int I = 1; I <= Nx; I++){
+
+                // Average children, skipping any past the edge of an odd grid
+                float sum = 0;
+                int count = 0;
+                for(int j = 2*J - 1; j <= 2*J && j <= Nyf; j++){
+                    for(int i = 2*I - 1; i <= 2*I && i <= Nxf; i++){
+                        sum += fine[i + (Nxf + 2)*j];
+                        count++;
+                    }
+                }
+                coarse[ind(I,J)] = 4 * sum / count;
+            }
+        }
+    });
+}
+
+// Bilinearly interpolate coarse field onto fine grid
+void Multigrid::Prolong(int coarseLevel, float * coarse, float * fine, bool addToFine)
+{
+    int Nx = levels[coarseLevel].Nx;
+    int Ny = levels[coarseLevel].Ny;
+    int Nxf = levels[coarseLevel - 1].Nx;
+    int Nyf = levels[coarseLevel - 1].Ny;
+
+    // Ghost cells supply neighbors at the edges
+    SimState::SetBoundary(0, coarse, Nx, Ny);
+
+    threadPool -> ParallelFor(1, Nyf + 1, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+
+            // Nearest coarse row and the next nearest
+            int J0 = (j + 1) / 2;
+            int J1 = (j % 2 == 1) ? J0 - 1 : J0 + 1;
+
+            for(int i = 1; i <= Nxf; i++){
+                int I0 = (i + 1) / 2;
+                int I1 = (i % 2 == 1) ? I0 - 1 : I0 + 1;
+
+                float value = 0.5625 * coarse[ind(I0,J0)] + 0.1875 * (coarse[ind(I1,J0)] + coarse[ind(I0,J1)]) +
+                              0.0625 * coarse[ind(I1,J1)];
+
+                if(addToFine){
+                    fine[i + (Nxf + 2)*j] += value;
+                }else{
+                    fine[i + (Nxf + 2)*j] = value;
+                }
+            }
+        }
+    });
+    SimState::SetBoundary(0, fine, Nxf, Nyf);
+}
+
+// Subtract average over interior cells
+void Multigrid::RemoveMean(int level, float * x)
+{
+    int Nx = levels[level].Nx;
+    int Ny = levels[level].Ny;
+
+    double sum = 0;
+    for(int j = 1; j <= Ny; j++){
+        for(int i = 1; i <= Nx; i++){
+            sum += x[ind(i,j)];
+        }
+    }
+    float mean = sum / (Nx * Ny);
+
+    for(int j = 1; j <= Ny; j++){
+        for(int i = 1; i <= Nx; i++){
+            x[ind(i,j)] -= mean;
+        }
+    }
+}
+
+// Euclidean norm over interior cells
+double Multigrid::Norm(int level, float * x)
+{
+    int Nx = levels[level].Nx;
+    int Ny = levels[level].Ny;
+
+    double sum = 0;
+    for(int j = 1; j <= Ny; j++){
+        for(int i = 1; i <= Nx; i++){
+            sum += x[ind(i,j)] * x[ind(i,j)];
+        }
+    }
+    return sqrt(sum);
+}
+
+// Relaxation sweeps for coarsest level, more for elongated grids
+int Multigrid::CoarseSweeps()
+{
+    const Level & coarsest = levels.back();
+    int aspect = (max(coarsest.Nx, coarsest.Ny) + min(coarsest.Nx, coarsest.Ny) - 1) / min(coarsest.Nx, coarsest.Ny);
+    return coarseSweeps * aspect;
+}
+
+// Zero all cells of field at level
+void Multigrid::Clear(int level, float * x)
+{
+    int size = (levels[level].Nx + 2) * (levels[level].Ny + 2);
+    for(int i = 0; i < size; i++){
+        x[i] = 0;
+    }
+}
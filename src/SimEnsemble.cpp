@@ -0,0 +1,149 @@
+/* Function definition file for ensembles of simulations stepped together */
+
+// Include header definitions
+#include "headers/SimEnsemble.h"
+
+// Includes and usings
+using namespace std;
+
+
+
+//// PUBLIC METHODS ////
+
+// Constructor taking param struct, for square grid
+template<int K>
+SimEnsemble<K>::SimEnsemble(int N, SimParams paramsIn) : SimEnsemble(N, N, paramsIn)
+{
+}
+
+// Constructor taking param struct, for grid of Nx by Ny cells
+template<int K>
+SimEnsemble<K>::SimEnsemble(int Nx, int Ny, SimParams paramsIn)
+{
+    this -> params = paramsIn;
+
+    // Lanes only hold fields, so they need no worker threads of their own
+    SimParams laneParams = params;
+    laneParams.numThreads = 1;
+    for(int k = 0; k < K; k++){
+        lanes.push_back(new SimState(Nx, Ny, laneParams));
+    }
+
+    batch = new BasicSimState<Lanes<float, K>>(Nx, Ny, params);
+    batch -> laneParams.resize(K);
+}
+
+// Destructor
+template<int K>
+SimEnsemble<K>::~SimEnsemble()
+{
+    delete batch;
+    for(SimState * lane : lanes){
+        delete lane;
+    }
+}
+
+// Run simulation step of every lane
+template<int K>
+void SimEnsemble<K>::SimulationStep(float timeStep)
+{
+    // Take shared options from ensemble and physical constants from each lane
+    batch -> params = params;
+    for(int k = 0; k < K; k++){
+        batch -> laneParams[k] = lanes[k] -> params;
+    }
+
+    // Gather sources of each lane
+    Interleave(batch -> fields.dens_source, &SimState::Fields::dens_source);
+    Interleave(batch -> fields.temp_source, &SimState::Fields::temp_source);
+    Interleave(batch -> fields.xVel_source, &SimState::Fields::xVel_source);
+    Interleave(batch -> fields.yVel_source, &SimState::Fields::yVel_source);
+
+    batch -> SimulationStep(timeStep);
+
+    // Hand each lane its fields
+    Deinterleave(batch -> fields.dens, &SimState::Fields::dens);
+    Deinterleave(batch -> fields.temp, &SimState::Fields::temp);
+    Deinterleave(batch -> fields.xVel, &SimState::Fields::xVel);
+    Deinterleave(batch -> fields.yVel, &SimState::Fields::yVel);
+    for(SimState * lane : lanes){
+        lane -> InvalidateMixedFields();
+    }
+}
+
+// Reset fields of every lane
+template<int K>
+void SimEnsemble<K>::ResetState()
+{
+    for(int k = 0; k < K; k++){
+        lanes[k] -> ResetState();
+        batch -> laneParams[k] = lanes[k] -> params;
+    }
+    batch -> params = params;
+    batch -> ResetState();
+}
+
+// Get simulation of one lane
+template<int K>
+SimState * SimEnsemble<K>::Lane(int k)
+{
+    return lanes[k];
+}
+
+// Get number of lanes
+template<int K>
+int SimEnsemble<K>::GetLanes()
+{
+    return K;
+}
+
+// Get grid size
+template<int K>
+int SimEnsemble<K>::GetNx()
+{
+    return batch -> GetNx();
+}
+
+template<int K>
+int SimEnsemble<K>::GetNy()
+{
+    return batch -> GetNy();
+}
+
+
+//// PRIVATE METHODS ////
+
+// Copy plane of every lane into lanes of x
+template<int K>
+void SimEnsemble<K>::Interleave(Lanes<float, K> * x, float * SimState::Fields::* plane)
+{
+    int size = (GetNx() + 2) * (GetNy() + 2);
+    for(int k = 0; k < K; k++){
+        float * lane = lanes[k] -> fields.*plane;
+        for(int i = 0; i < size; i++){
+            x[i].v[k] = lane[i];
+        }
+    }
+}
+
+// Copy lanes of x into plane of every lane
+template<int K>
+void SimEnsemble<K>::Deinterleave(Lanes<float, K> * x, float * SimState::Fields::* plane)
+{
+    int size = (GetNx() + 2) * (GetNy() + 2);
+    for(int k = 0; k < K; k++){
+        float * lane = lanes[k] -> fields.*plane;
+        for(int i = 0; i < size; i++){
+            lane[i] = x[i].v[k];
+        }
+    }
+}
+
+
+
+/// INSTANTIATIONS ///
+
+// Common vector widths: SSE and NEON, AVX2, and AVX-512
+template class SimEnsemble<4>;
+template class SimEnsemble<8>;
+template class SimEnsemble<16>;
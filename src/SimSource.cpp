@@ -3,15 +3,17 @@
 #include "headers/SimSource.h"
 #include <cmath>
 #include <iostream>
+#include <limits>
 using namespace std;
 
 // Macros
-#define indN(i,j,N) ((i) + ((N) + 2)*(j))
+#define indN(i,j,Nx) ((i) + ((Nx) + 2)*(j))
 
 /// SIMSOURCES METHODS ///
 
 // Constructor, taking SimState reference as input
-SimSource::SimSource(SimState* simState)
+template<typename Scalar>
+BasicSimSource<Scalar>::BasicSimSource(BasicSimState<Scalar>* simState)
 {
     // Save pointer to SimState
     this -> simState = simState;
@@ -23,61 +25,110 @@ SimSource::SimSource(SimState* simState)
     temp = simState -> fields.temp_source;
 }
 
+// Constructor for sources laid out on a grid of Nx by Ny cells without a SimState,
+// applied to a simulation only through ApplySources
+template<typename Scalar>
+BasicSimSource<Scalar>::BasicSimSource(int Nx, int Ny, float lengthScale)
+{
+    simState = nullptr;
+    gridNx = Nx;
+    gridNy = Ny;
+    gridLengthScale = lengthScale;
+
+    xVel = nullptr;
+    yVel = nullptr;
+    dens = nullptr;
+    temp = nullptr;
+}
+
 // Update sources in SimState object
-void SimSource::UpdateSources()
+template<typename Scalar>
+void BasicSimSource<Scalar>::UpdateSources()
 {
+    if(!simState){
+        return;
+    }
+
     // Zero out sources first
     simState -> ResetSources();
 
     // Loop through list of sources
-    for (const Source* source : sources){
-
-        // Loop through source indices
-        for(const int & index : source -> indices){
-
-            xVel[index] += source -> xVel;
-            yVel[index] += source -> yVel;
-            dens[index] += source -> dens;
-            temp[index] = max(temp[index], source -> temp);
-        }
-    }
+    ForSourceValues(false, [&](int index, float u, float v, float d, float t){
+        xVel[index] += u;
+        yVel[index] += v;
+        dens[index] = dens[index] + d;
+        temp[index] = max<float>(temp[index], t);
+    });
 }
 
 // Update sources with dynamic processes
-void SimSource::UpdateSourcesDynamic()
+template<typename Scalar>
+void BasicSimSource<Scalar>::UpdateSourcesDynamic()
 {
+    if(!simState){
+        return;
+    }
+
     // Zero out sources first
     simState -> ResetSources();
 
+    // Loop through list of sources
+    ForSourceValues(true, [&](int index, float u, float v, float d, float t){
+        xVel[index] += u;
+        yVel[index] += v;
+        dens[index] = dens[index] + d;
+        temp[index] = max<float>(temp[index], t);
+    });
+}
+
+// Apply sources with dynamic processes to cells of another simulation, through
+// add(i, j, xVel, yVel, dens, temp), which adds velocity and density to any already
+// applied to cell (i, j) and raises its source temperature to temp
+template<typename Scalar>
+void BasicSimSource<Scalar>::ApplySources(const std::function<void(int i, int j, float xVel, float yVel, float dens, float temp)> & add)
+{
+    int stride = GridNx() + 2;
+    ForSourceValues(true, [&](int index, float u, float v, float d, float t){
+        add(index % stride, index / stride, u, v, d, t);
+    });
+}
+
+// Values each source adds to each of its cells, drawn afresh for dynamic sources if
+// dynamic is set, leaving temperature at its lowest for sources not heating
+template<typename Scalar>
+void BasicSimSource<Scalar>::ForSourceValues(bool dynamic, const std::function<void(int index, float xVel, float yVel, float dens, float temp)> & apply)
+{
+    const float noHeat = -numeric_limits<float>::infinity();
+
     // Loop through list of sources
     for (const Source* source : sources){
 
-        if(source -> isDynamic){
+        if(dynamic && source -> isDynamic){
 
             // Loop through source indices
             for(const int & index : source -> indices){
 
-                float ang, spd;
+                float ang, spd, d, t;
 
                 switch(source -> type){
                     case gas:
-                        dens[index] += RandomNormal(source -> dens, source -> dVar);
-                        temp[index] = max(temp[index], RandomNormal(source -> temp, source -> tVar));
+                        d = RandomNormal(source -> dens, source -> dVar);
+                        t = RandomNormal(source -> temp, source -> tVar);
+                        apply(index, 0.0, 0.0, d, t);
                         break;
                     case wind:
                         ang = RandomNormal(source -> aMean, source -> aVar);
                         spd = RandomNormal(source -> wMean, source -> wVar);
-                        xVel[index] += spd * cos(ang * 3.14159265 / 180.0);
-                        yVel[index] += spd * sin(ang * 3.14159265 / 180.0);
+                        apply(index, spd * cos(ang * 3.14159265 / 180.0), spd * sin(ang * 3.14159265 / 180.0), 0.0, noHeat);
                         break;
                     case heat:
-                        temp[index] = max(temp[index], RandomNormal(source -> temp, source -> tVar));
+                        apply(index, 0.0, 0.0, 0.0, RandomNormal(source -> temp, source -> tVar));
                         break;
                     case energy:
-                        temp[index] = max(temp[index], RandomNormal(source -> temp, source -> tVar));
+                        apply(index, 0.0, 0.0, 0.0, RandomNormal(source -> temp, source -> tVar));
                         break;
                     case windBoundary:
-                        xVel[index] += RandomNormal(source -> wMean, source -> wVar);
+                        apply(index, RandomNormal(source -> wMean, source -> wVar), 0.0, 0.0, noHeat);
                         break;
                 }
             }
@@ -86,33 +137,38 @@ void SimSource::UpdateSourcesDynamic()
 
             // Loop through source indices
             for(const int & index : source -> indices){
-
-                xVel[index] += source -> xVel;
-                yVel[index] += source -> yVel;
-                dens[index] += source -> dens;
-                temp[index] = max(temp[index], source -> temp);
+                apply(index, source -> xVel, source -> yVel, source -> dens, source -> temp);
             }
 
         }
     }
 }
 
+// Grid sources are laid out on, from the SimState if there is one
+template<typename Scalar>
+int BasicSimSource<Scalar>::GridNx() { return simState ? simState -> GetNx() : gridNx; }
+template<typename Scalar>
+int BasicSimSource<Scalar>::GridNy() { return simState ? simState -> GetNy() : gridNy; }
+template<typename Scalar>
+float BasicSimSource<Scalar>::GridLengthScale() { return simState ? simState -> params.lengthScale : gridLengthScale; }
+
 // Calculate indices covered by shape
-void SimSource::Source::SetIndices(int N, Shape shape, float xCenter, float yCenter, float radius)
+void SimSourceBase::Source::SetIndices(int Nx, int Ny, Shape shape, float xCenter, float yCenter, float radius)
 {
-    float xCInd = float(N + 2) * (xCenter + 1.0) / 2.0;
-    float yCInd = float(N + 2) * (yCenter + 1.0) / 2.0;
+    float xCInd = float(Nx + 2) * (xCenter + 1.0) / 2.0;
+    float yCInd = float(Ny + 2) * (yCenter + 1.0) / 2.0;
 
     if(shape == point){
-        indices.push_back(indN(int(round(xCInd)), int(round(yCInd)), N));
+        indices.push_back(indN(int(round(xCInd)), int(round(yCInd)), Nx));
         return;
     }
 
-    float rInd  = N * radius / 2.0;
+    // Radius is relative to grid width, so shapes stay round on square cells
+    float rInd  = Nx * radius / 2.0;
     float xMinInd = max(floor(xCInd - rInd), 0.0f);
-    float xMaxInd = min(ceil( xCInd + rInd), float(N+2));
+    float xMaxInd = min(ceil( xCInd + rInd), float(Nx+1));
     float yMinInd = max(floor(yCInd - rInd), 0.0f);
-    float yMaxInd = min(ceil( yCInd + rInd), float(N+2));
+    float yMaxInd = min(ceil( yCInd + rInd), float(Ny+1));
 
 
     for(float x = xMinInd; x <= xMaxInd; x++){
@@ -121,18 +177,18 @@ void SimSource::Source::SetIndices(int N, Shape shape, float xCenter, float yCen
             switch(shape){
 
                 case square:
-                    indices.push_back(indN(int(x), float(y), N));
+                    indices.push_back(indN(int(x), float(y), Nx));
                     break;
 
                 case circle:
                     if((x - xCInd) * (x - xCInd) + (y - yCInd) * (y - yCInd) <= rInd * rInd){
-                        indices.push_back(indN(int(x), float(y), N));
+                        indices.push_back(indN(int(x), float(y), Nx));
                     }
                     break;
 
                 case diamond:
                     if(abs(x - xCInd) + abs(y - yCInd) <= rInd ){
-                        indices.push_back(indN(int(x), float(y), N));
+                        indices.push_back(indN(int(x), float(y), Nx));
                     }
                     break;
             }
@@ -141,24 +197,26 @@ void SimSource::Source::SetIndices(int N, Shape shape, float xCenter, float yCen
 
     // Return single point if size is too small to cover any integral points
     if(indices.size() == 0){
-        indices.push_back(indN(int(round(xCInd)), int(round(yCInd)), N));
+        indices.push_back(indN(int(round(xCInd)), int(round(yCInd)), Nx));
     }
 }
 
 
 
 // Create gas source and add to source list
-void SimSource::CreateGasSource(Shape shape, float flowRate, float sourceTemp, float xCenter, float yCenter, float radius)
+template<typename Scalar>
+void BasicSimSource<Scalar>::CreateGasSource(Shape shape, float flowRate, float sourceTemp, float xCenter, float yCenter, float radius)
 {
-    GasSource* newGasSource = new GasSource(simState->GetN(), simState->params.lengthScale, shape, flowRate, sourceTemp, xCenter, yCenter, radius);
+    GasSource* newGasSource = new GasSource(GridNx(), GridNy(), GridLengthScale(), shape, flowRate, sourceTemp, xCenter, yCenter, radius);
     Source* newSource = newGasSource;
     sources.push_back(newSource);
 }
 
 // Create dynamic gas source and add to source list
-void SimSource::CreateGasSourceDynamic(Shape shape, float flowRate, float sourceTemp, float xCenter, float yCenter, float radius, float flowVar, float tempVar)
+template<typename Scalar>
+void BasicSimSource<Scalar>::CreateGasSourceDynamic(Shape shape, float flowRate, float sourceTemp, float xCenter, float yCenter, float radius, float flowVar, float tempVar)
 {
-    GasSource* newGasSource = new GasSource(simState->GetN(), simState->params.lengthScale, shape, flowRate, sourceTemp, xCenter, yCenter, radius);
+    GasSource* newGasSource = new GasSource(GridNx(), GridNy(), GridLengthScale(), shape, flowRate, sourceTemp, xCenter, yCenter, radius);
     newGasSource -> isDynamic = true;
     newGasSource -> dVar = flowVar;
     newGasSource -> tVar = tempVar;
@@ -167,14 +225,14 @@ void SimSource::CreateGasSourceDynamic(Shape shape, float flowRate, float source
 }
 
 // Gas source constructor
-SimSource::GasSource::GasSource(int N, float lengthScale, Shape shape, float flowRate, float sourceTemp, float xCenter, float yCenter, float radius)
+SimSourceBase::GasSource::GasSource(int Nx, int Ny, float lengthScale, Shape shape, float flowRate, float sourceTemp, float xCenter, float yCenter, float radius)
 {
     // Set source indices
     this -> xCenter = xCenter;
     this -> yCenter = yCenter;
     this -> radius = radius;
     this -> shape = shape;
-    SetIndices(N, shape, xCenter, yCenter, radius);
+    SetIndices(Nx, Ny, shape, xCenter, yCenter, radius);
 
     // Calculate sources
     this -> type = gas;
@@ -185,17 +243,19 @@ SimSource::GasSource::GasSource(int N, float lengthScale, Shape shape, float flo
 }
 
 // Create wind source and add to source list
-void SimSource::CreateWindSource(float angle, float speed, float xCenter, float yCenter)
+template<typename Scalar>
+void BasicSimSource<Scalar>::CreateWindSource(float angle, float speed, float xCenter, float yCenter)
 {
-    WindSource* newWindSource = new WindSource(simState->GetN(), simState->params.lengthScale, angle, speed, xCenter, yCenter);
+    WindSource* newWindSource = new WindSource(GridNx(), GridNy(), GridLengthScale(), angle, speed, xCenter, yCenter);
     Source* newSource = newWindSource;
     sources.push_back(newSource);
 }
 
 // Create dynamic wind source and add to source list
-void SimSource::CreateWindSourceDynamic(float angle, float speed, float xCenter, float yCenter, float speedVar, float angleVar)
+template<typename Scalar>
+void BasicSimSource<Scalar>::CreateWindSourceDynamic(float angle, float speed, float xCenter, float yCenter, float speedVar, float angleVar)
 {
-    WindSource* newWindSource = new WindSource(simState->GetN(), simState->params.lengthScale, angle, speed, xCenter, yCenter);
+    WindSource* newWindSource = new WindSource(GridNx(), GridNy(), GridLengthScale(), angle, speed, xCenter, yCenter);
     newWindSource -> isDynamic = true;
     newWindSource -> wMean = speed;
     newWindSource -> aMean = angle;
@@ -206,7 +266,7 @@ void SimSource::CreateWindSourceDynamic(float angle, float speed, float xCenter,
 }
 
 // Wind source constructor
-SimSource::WindSource::WindSource(int N, float lengthScale, float angle, float speed, float xCenter, float yCenter)
+SimSourceBase::WindSource::WindSource(int Nx, int Ny, float lengthScale, float angle, float speed, float xCenter, float yCenter)
 {
     // Calculate sources
     this -> type = wind;
@@ -220,21 +280,23 @@ SimSource::WindSource::WindSource(int N, float lengthScale, float angle, float s
     this -> yCenter = yCenter;
     this -> radius = 0.0;
     this -> shape = point;
-    SetIndices(N, point, xCenter, yCenter, 0.0);
+    SetIndices(Nx, Ny, point, xCenter, yCenter, 0.0);
 }
 
 // Create heat source and add to source list
-void SimSource::CreateHeatSource(Shape shape, float sourceTemp, float xCenter, float yCenter, float radius)
+template<typename Scalar>
+void BasicSimSource<Scalar>::CreateHeatSource(Shape shape, float sourceTemp, float xCenter, float yCenter, float radius)
 {
-    HeatSource* newHeatSource = new HeatSource(simState->GetN(), simState->params.lengthScale, shape, sourceTemp, xCenter, yCenter, radius);
+    HeatSource* newHeatSource = new HeatSource(GridNx(), GridNy(), GridLengthScale(), shape, sourceTemp, xCenter, yCenter, radius);
     Source* newSource = newHeatSource;
     sources.push_back(newSource);
 }
 
 // Create heat source and add to source list
-void SimSource::CreateHeatSourceDynamic(Shape shape, float sourceTemp, float xCenter, float yCenter, float radius, float tempVar)
+template<typename Scalar>
+void BasicSimSource<Scalar>::CreateHeatSourceDynamic(Shape shape, float sourceTemp, float xCenter, float yCenter, float radius, float tempVar)
 {
-    HeatSource* newHeatSource = new HeatSource(simState->GetN(), simState->params.lengthScale, shape, sourceTemp, xCenter, yCenter, radius);
+    HeatSource* newHeatSource = new HeatSource(GridNx(), GridNy(), GridLengthScale(), shape, sourceTemp, xCenter, yCenter, radius);
     newHeatSource -> isDynamic = true;
     newHeatSource -> tVar = tempVar;
     Source* newSource = newHeatSource;
@@ -242,7 +304,7 @@ void SimSource::CreateHeatSourceDynamic(Shape shape, float sourceTemp, float xCe
 }
 
 // Heat source constructor
-SimSource::HeatSource::HeatSource(int N, float lengthScale, Shape shape, float sourceTemp, float xCenter, float yCenter, float radius)
+SimSourceBase::HeatSource::HeatSource(int Nx, int Ny, float lengthScale, Shape shape, float sourceTemp, float xCenter, float yCenter, float radius)
 {
     // Calculate sources
     this -> type = heat;
@@ -256,21 +318,23 @@ SimSource::HeatSource::HeatSource(int N, float lengthScale, Shape shape, float s
     this -> yCenter = yCenter;
     this -> radius = radius;
     this -> shape = shape;
-    SetIndices(N, shape, xCenter, yCenter, radius);
+    SetIndices(Nx, Ny, shape, xCenter, yCenter, radius);
 }
 
 // Create gas source and add to source list
-void SimSource::CreateEnergySource(Shape shape, float flux, float referenceTemp, float referenceDensity, float xCenter, float yCenter, float radius)
+template<typename Scalar>
+void BasicSimSource<Scalar>::CreateEnergySource(Shape shape, float flux, float referenceTemp, float referenceDensity, float xCenter, float yCenter, float radius)
 {
-    EnergySource* newEnergySource = new EnergySource(simState->GetN(), simState->params.lengthScale, shape, flux, referenceTemp, referenceDensity, xCenter, yCenter, radius);
+    EnergySource* newEnergySource = new EnergySource(GridNx(), GridNy(), GridLengthScale(), shape, flux, referenceTemp, referenceDensity, xCenter, yCenter, radius);
     Source* newSource = newEnergySource;
     sources.push_back(newSource);
 }
 
 // Create gas source and add to source list
-void SimSource::CreateEnergySourceDynamic(Shape shape, float flux, float referenceTemp, float referenceDensity, float xCenter, float yCenter, float radius, float fluxVar)
+template<typename Scalar>
+void BasicSimSource<Scalar>::CreateEnergySourceDynamic(Shape shape, float flux, float referenceTemp, float referenceDensity, float xCenter, float yCenter, float radius, float fluxVar)
 {
-    EnergySource* newEnergySource = new EnergySource(simState->GetN(), simState->params.lengthScale, shape, flux, referenceTemp, referenceDensity, xCenter, yCenter, radius);
+    EnergySource* newEnergySource = new EnergySource(GridNx(), GridNy(), GridLengthScale(), shape, flux, referenceTemp, referenceDensity, xCenter, yCenter, radius);
     newEnergySource -> isDynamic = true;
     newEnergySource -> tVar = fluxVar;
     Source* newSource = newEnergySource;
@@ -278,18 +342,20 @@ void SimSource::CreateEnergySourceDynamic(Shape shape, float flux, float referen
 }
 
 // Gas source constructor
-SimSource::EnergySource::EnergySource(int N, float lengthScale, Shape shape, float flux, float referenceTemp,  float referenceDensity, float xCenter, float yCenter, float radius)
+SimSourceBase::EnergySource::EnergySource(int Nx, int Ny, float lengthScale, Shape shape, float flux, float referenceTemp,  float referenceDensity, float xCenter, float yCenter, float radius)
 {
     // Set source indices
     this -> xCenter = xCenter;
     this -> yCenter = yCenter;
     this -> radius = radius;
     this -> shape = shape;
-    SetIndices(N, shape, xCenter, yCenter, radius);
+    SetIndices(Nx, Ny, shape, xCenter, yCenter, radius);
 
     // Calculate sources
     // NOTE: 12.5 adjusts for simple linear heat transfer
     this -> type = energy;
+    this -> flux = flux;
+    this -> referenceTemp = referenceTemp;
     this -> dens = 0.0;
     this -> temp = referenceTemp + (flux / (12.5 * referenceDensity * indices.size()));
     this -> xVel = 0.0;
@@ -297,7 +363,8 @@ SimSource::EnergySource::EnergySource(int N, float lengthScale, Shape shape, flo
 }
 
 // Create wind across left and right boundaries
-void SimSource::CreateWindBoundary(float speed)
+template<typename Scalar>
+void BasicSimSource<Scalar>::CreateWindBoundary(float speed)
 {
     // Remove any other wind boundaries
     for(Source* source : sources){
@@ -307,13 +374,14 @@ void SimSource::CreateWindBoundary(float speed)
         }
     }
 
-    WindBoundary* newWindBoundary = new WindBoundary(simState->GetN(), speed);
+    WindBoundary* newWindBoundary = new WindBoundary(GridNx(), GridNy(), speed);
     Source* newSource = newWindBoundary;
     sources.push_back(newSource);
 }
 
 // Create wind across left and right boundaries
-void SimSource::CreateWindBoundaryDynamic(float speed, float speedVar)
+template<typename Scalar>
+void BasicSimSource<Scalar>::CreateWindBoundaryDynamic(float speed, float speedVar)
 {
     // Remove any other wind boundaries
     for(Source* source : sources){
@@ -323,7 +391,7 @@ void SimSource::CreateWindBoundaryDynamic(float speed, float speedVar)
         }
     }
 
-    WindBoundary* newWindBoundary = new WindBoundary(simState->GetN(), speed);
+    WindBoundary* newWindBoundary = new WindBoundary(GridNx(), GridNy(), speed);
     newWindBoundary -> isDynamic = true;
     newWindBoundary -> wVar = speedVar;
     newWindBoundary -> wMean = speed;
@@ -332,7 +400,7 @@ void SimSource::CreateWindBoundaryDynamic(float speed, float speedVar)
 }
 
 // Wind boundary constructor
-SimSource::WindBoundary::WindBoundary(int N, float speed)
+SimSourceBase::WindBoundary::WindBoundary(int Nx, int Ny, float speed)
 {
     // Set sources
     this -> type = windBoundary;
@@ -342,31 +410,41 @@ SimSource::WindBoundary::WindBoundary(int N, float speed)
     this -> yVel = 0.0;
 
     // Set source indices
-    for(int i = 0; i < N+1; i++){
+    SetBoundaryIndices(Nx, Ny);
+}
+
+// Calculate indices along left and right boundaries
+void SimSourceBase::WindBoundary::SetBoundaryIndices(int Nx, int Ny)
+{
+    for(int i = 0; i < Ny+1; i++){
 
         // Set left and right boundaries
-        indices.push_back(indN(1,i,N));
-        indices.push_back(indN(N,i,N));
+        indices.push_back(indN(1,i,Nx));
+        indices.push_back(indN(Nx,i,Nx));
     }
 }
 
 
 
 // Remove source
-void SimSource::RemoveSource(Source* sourceToRemove)
+template<typename Scalar>
+void BasicSimSource<Scalar>::RemoveSource(Source* sourceToRemove)
 {
     // Remove from source list
         sources.remove(sourceToRemove);
         delete sourceToRemove;
 
     // Propogate change to simulation
-    simState->ResetSources();
     UpdateSources();
 }
 
 // Find source that overlaps with point and remove it
-void SimSource::RemoveSourceAtPoint(float x, float y, float dist)
+template<typename Scalar>
+void BasicSimSource<Scalar>::RemoveSourceAtPoint(float x, float y, float dist)
 {
+    // Vertical distances in units of grid width
+    float aspect = float(GridNy()) / GridNx();
+
     // Loop through sources
     for(Source* source : sources){
 
@@ -377,7 +455,7 @@ void SimSource::RemoveSourceAtPoint(float x, float y, float dist)
 
             float rad = source->radius + dist;
             float xDist = abs(x - source->xCenter);
-            float yDist = abs(y - source->yCenter);
+            float yDist = abs(y - source->yCenter) * aspect;
 
             switch(source->shape){
                 case circle:
@@ -414,22 +492,26 @@ void SimSource::RemoveSourceAtPoint(float x, float y, float dist)
 }
 
 // Remove all sources
-void SimSource::RemoveAllSources()
+template<typename Scalar>
+void BasicSimSource<Scalar>::RemoveAllSources()
 {
     // Pop all and reset state
     while(sources.size() > 0){
         delete sources.back();
         sources.pop_back();
     }
-    simState->ResetSources();
     UpdateSources();
 }
 
 // Resize grid to N + 2 by N + 2
-void SimSource::Reset()
+template<typename Scalar>
+void BasicSimSource<Scalar>::Reset()
 {
     // Remove all sources
     RemoveAllSources();
+    if(!simState){
+        return;
+    }
 
     // Retrieve pointers to source arrays
     xVel = simState -> fields.xVel_source;
@@ -438,6 +520,54 @@ void SimSource::Reset()
     temp = simState -> fields.temp_source;
 }
 
+// Move sources onto resized grid, keeping their positions and total rates
+template<typename Scalar>
+void BasicSimSource<Scalar>::Resize()
+{
+    // Only sources of a SimState follow its grid
+    if(!simState){
+        return;
+    }
+
+    // Retrieve pointers to new source arrays
+    xVel = simState -> fields.xVel_source;
+    yVel = simState -> fields.yVel_source;
+    dens = simState -> fields.dens_source;
+    temp = simState -> fields.temp_source;
+
+    int Nx = simState -> GetNx();
+    int Ny = simState -> GetNy();
+    for(Source* source : sources){
+
+        // Recalculate covered cells
+        float oldCount = source -> indices.size();
+        source -> indices.clear();
+        if(source -> type == windBoundary){
+            static_cast<WindBoundary*>(source) -> SetBoundaryIndices(Nx, Ny);
+        }else{
+            source -> SetIndices(Nx, Ny, source -> shape, source -> xCenter, source -> yCenter, source -> radius);
+        }
+
+        // Spread totals over new cell count
+        float scale = oldCount / source -> indices.size();
+        if(source -> type == gas){
+            source -> dens *= scale;
+        }else if(source -> type == energy){
+            float referenceTemp = static_cast<EnergySource*>(source) -> referenceTemp;
+            source -> temp = referenceTemp + (source -> temp - referenceTemp) * scale;
+        }
+    }
+
+    // Propogate change to simulation
+    UpdateSources();
+}
+
+// Source sets for each field storage precision
+template class BasicSimSource<float>;
+template class BasicSimSource<double>;
+template class BasicSimSource<Half>;
+template class BasicSimSource<BFloat16>;
+
 // Non-class functions //
 
 // Generate normal distributed random variable
@@ -3,53 +3,92 @@
 
 // Include header definition
 #include "headers/SimState.h"
+#include "headers/Advection.h"
 
 // Includes and usings
 #include <iostream>
 #include <cmath>
+#include <cstdlib>
+#include <type_traits>
+#include <new>
+#include <stdexcept>
+#include <vector>
+#include <sys/mman.h>
 using namespace std;
 
 // Macros
-#define ind(i,j) ((i) + (N + 2)*(j))
-#define swap(x0, x) {float *tmp = x0; x0 = x; x = tmp;}
+#define ind(i,j) ((i) + (Nx + 2)*(j))
+#define swap(x0, x) {auto tmp = x0; x0 = x; x = tmp;}
+
+// Cells of each row relaxed in turn within a wavefront
+static const int wavefrontCells = 4;
 
 
 
 //// SIMSTATE PUBLIC METHODS ////
 
 // Constructor without physical properties
-SimState::SimState(int N)
+template<typename Scalar>
+BasicSimState<Scalar>::BasicSimState(int N) : BasicSimState(N, N, SimParams())
 {
-    // Property initializations
-    this -> N = N;
-    this -> size = (N + 2) * (N + 2);
+}
 
-    // Struct initializations
-    this -> params = SimParams();
-    this -> fields = SimFields(size);
+// Constructor without physical properties, for grid of Nx by Ny cells
+template<typename Scalar>
+BasicSimState<Scalar>::BasicSimState(int Nx, int Ny) : BasicSimState(Nx, Ny, SimParams())
+{
+}
 
-    // Zero out all arrays
-    ResetState();
+// Constructor taking param struct, for square grid
+template<typename Scalar>
+BasicSimState<Scalar>::BasicSimState(int N, SimParams paramsIn) : BasicSimState(N, N, paramsIn)
+{
 }
 
-// Constructor taking param struct
-SimState::SimState(int N, SimParams paramsIn)
+// Constructor taking param struct, for grid of Nx by Ny cells
+template<typename Scalar>
+BasicSimState<Scalar>::BasicSimState(int Nx, int Ny, SimParams paramsIn)
 {
     // Property initializations
-    this -> N = N;
-    this -> size = (N + 2) * (N + 2);
+    this -> Nx = Nx;
+    this -> Ny = Ny;
+    this -> size = (Nx + 2) * (Ny + 2);
 
     // Struct initializations
     this -> params = paramsIn;
-    this -> fields = SimFields(size);
+    this -> fields = Fields(size, params.hugePages);
+
+    // Start worker threads
+    threadPool = new ThreadPool(params.numThreads);
+    multigrid = nullptr;
+    conjugateGradient = nullptr;
+    ClearSolveStats();
+    substeps = 0;
+    cfl = -1;
+    active = {1, Nx + 1, 1, Ny + 1};
+    activePartial = false;
+    coefficientsConstant = false;
+    heldSides = 0;
+    mixedFieldsCurrent = false;
 
     // Zero out all arrays
     ResetState();
 }
 
+// Destructor
+template<typename Scalar>
+BasicSimState<Scalar>::~BasicSimState()
+{
+    // Stop worker threads and free solvers
+    delete multigrid;
+    delete conjugateGradient;
+    delete threadPool;
+}
+
 
 // Set pointers to density and velocity sources
-void SimState::SetSources(float * density, float * xVelocity, float * yVelocity, float * temperature)
+template<typename Scalar>
+void BasicSimState<Scalar>::SetSources(Scalar * density, Real * xVelocity, Real * yVelocity, Scalar * temperature)
 {
     // Pass into struct
     fields.dens_source = density;
@@ -59,129 +98,343 @@ void SimState::SetSources(float * density, float * xVelocity, float * yVelocity,
 }
 
 // Run simulation step
-void SimState::SimulationStep(float timeStep)
+template<typename Scalar>
+void BasicSimState<Scalar>::SimulationStep(float timeStep)
 {
     // Adjust for time scale
     float dt = timeStep * params.timeScale;
 
-    // Set sources as input
-    SetSource(fields.dens_prev, fields.dens_source);
-    SetSource(fields.xVel_prev, fields.xVel_source);
-    SetSource(fields.yVel_prev, fields.yVel_source);
-    SetSource(fields.temp_prev, fields.temp_source);
+    // Match worker threads to requested count
+    UpdateThreadPool();
 
-    // Start futher simulation steps
-    VelocityStep(dt);
-    DensityStep(dt);
-    if(params.temperatureOn)
-        TemperatureStep(dt);
+    // Clear solver statistics from last step
+    ClearSolveStats();
+
+    // Save ghost cells set by the caller for every substep
+    if(heldSides){
+        HoldBoundaries();
+    }
+
+    // Take physical constants of every lane for this step
+    UpdateConstants();
+
+    // Take whole step at once unless adaptive
+    substeps = 0;
+    cfl = -1;
+    if(!params.adaptiveTimeStep){
+        DispatchStep(dt);
+        substeps = 1;
+        return;
+    }
+
+    // Split remaining time into the fewest substeps keeping the CFL number under target,
+    // measuring velocity again before each substep as forces may have sped up the flow.
+    // Counts are capped before conversion, so a zero target or unbounded speed stays defined
+    float target = max(params.targetCFL, 0.01f);
+    float cellSize = params.lengthScale / Nx;
+    float remaining = dt;
+    while(true){
+        float remainingCFL = MaxSpeed() * remaining / cellSize;
+        float limit = max(1, params.maxSubsteps - substeps);
+        int count = (int)min(max(1.0f, ceil(remainingCFL / target)), limit);
+
+        // Take one substep of the even split
+        float h = remaining / count;
+        cfl = max(cfl, remainingCFL / count);
+        DispatchStep(h);
+        substeps++;
+        if(count == 1){
+            break;
+        }
+        remaining -= h;
+    }
+}
+
+// Run one step of the variant selected by option flags
+template<typename Scalar>
+void BasicSimState<Scalar>::DispatchStep(float dt)
+{
+    // Flags are read once here, so toggling them takes effect on the next step
+    int variant = 8 * params.closedBoundaries + 4 * params.gravityOn +
+                  2 * params.temperatureOn + params.advancedCoefficients;
+
+    // Cells this step updates
+    UpdateActiveRegion(dt);
+
+    // Run step specialized for closed boundaries, gravity, temperature, and advanced coefficients
+    switch(variant){
+        case  0: StepVariant<false, false, false, false>(dt); break;
+        case  1: StepVariant<false, false, false, true >(dt); break;
+        case  2: StepVariant<false, false, true,  false>(dt); break;
+        case  3: StepVariant<false, false, true,  true >(dt); break;
+        case  4: StepVariant<false, true,  false, false>(dt); break;
+        case  5: StepVariant<false, true,  false, true >(dt); break;
+        case  6: StepVariant<false, true,  true,  false>(dt); break;
+        case  7: StepVariant<false, true,  true,  true >(dt); break;
+        case  8: StepVariant<true,  false, false, false>(dt); break;
+        case  9: StepVariant<true,  false, false, true >(dt); break;
+        case 10: StepVariant<true,  false, true,  false>(dt); break;
+        case 11: StepVariant<true,  false, true,  true >(dt); break;
+        case 12: StepVariant<true,  true,  false, false>(dt); break;
+        case 13: StepVariant<true,  true,  false, true >(dt); break;
+        case 14: StepVariant<true,  true,  true,  false>(dt); break;
+        case 15: StepVariant<true,  true,  true,  true >(dt); break;
+        default: throw logic_error("Invalid step variant " + to_string(variant));
+    }
 }
 
 // Set boundaries open/closed
-void SimState::SetBoundaryClosed(bool isClosed)
+template<typename Scalar>
+void BasicSimState<Scalar>::SetBoundaryClosed(bool isClosed)
 {
     params.closedBoundaries = isClosed;
 }
 
+// Keep ghost cells of sides as set between steps instead of evaluating walls there, for
+// grids whose edges are fed by a surrounding simulation
+template<typename Scalar>
+void BasicSimState<Scalar>::SetBoundaryHeld(int sides)
+{
+    heldSides = sides & allSides;
+}
+
 // Reset to initial state of system
-void SimState::ResetState()
+template<typename Scalar>
+void BasicSimState<Scalar>::ResetState()
 {
     // Initialize arrays to 0
+    UpdateConstants();
     SetConstantSource(fields.dens, 0.0);
     SetConstantSource(fields.xVel, 0.0);
     SetConstantSource(fields.yVel, 0.0);
-    SetConstantSource(fields.temp, params.airTemp);
+    SetConstantSource(fields.temp, constants.airTemp);
     SetConstantSource(fields.dens_prev, 0.0);
     SetConstantSource(fields.xVel_prev, 0.0);
     SetConstantSource(fields.yVel_prev, 0.0);
-    SetConstantSource(fields.temp_prev, params.airTemp);
+    SetConstantSource(fields.temp_prev, constants.airTemp);
     SetConstantSource(fields.dens_source, 0.0);
     SetConstantSource(fields.xVel_source, 0.0);
     SetConstantSource(fields.yVel_source, 0.0);
-    SetConstantSource(fields.temp_source, params.airTemp);
+    SetConstantSource(fields.temp_source, constants.airTemp);
+    SetConstantSource(fields.pres, 0.0);
+    SetConstantSource(fields.pres_advect, 0.0);
+    mixedFieldsCurrent = false;
 }
 
 // Reset sources to initial state
-void SimState::ResetSources()
+template<typename Scalar>
+void BasicSimState<Scalar>::ResetSources()
 {
     // Zero source arrays
+    UpdateConstants();
     SetConstantSource(fields.dens_source, 0.0);
     SetConstantSource(fields.xVel_source, 0.0);
     SetConstantSource(fields.yVel_source, 0.0);
-    SetConstantSource(fields.temp_source, params.airTemp);
+    SetConstantSource(fields.temp_source, constants.airTemp);
 }
 
 // Modify grid parameters
-void SimState::ResizeGrid(int N)
+template<typename Scalar>
+void BasicSimState<Scalar>::ResizeGrid(int Nx, int Ny)
 {
     // Property initializations
-    this -> N = N;
-    this -> size = (N + 2) * (N + 2);
+    this -> Nx = Nx;
+    this -> Ny = Ny;
+    this -> size = (Nx + 2) * (Ny + 2);
 
-    // Delete old field object and create new one
+    // Free old fields before allocating new ones
     fields.ClearFields();
-    SimFields fields(size);
-    this -> fields = fields;
+    fields = Fields(size, params.hugePages);
+    coefficientsConstant = false;
 
     // Zero out all arrays
     ResetState();
 }
 
+// Start allocating fields for a new grid size on a background thread
+template<typename Scalar>
+void BasicSimState<Scalar>::RequestResize(int Nx, int Ny)
+{
+    // Let any earlier request finish first, then replace it
+    if(pendingFields.valid()){
+        pendingFields.wait();
+    }
+
+    // Allocate off the simulation thread, leaving pages to be first touched by the
+    // worker threads when the grid is swapped in
+    int size = (Nx + 2) * (Ny + 2);
+    bool hugePages = params.hugePages;
+    pendingNx = Nx;
+    pendingNy = Ny;
+    pendingFields = async(launch::async, [size, hugePages](){
+        return Fields(size, hugePages);
+    });
+}
+
+// Swap in requested grid if ready, resampling fields onto it; call between steps
+template<typename Scalar>
+bool BasicSimState<Scalar>::FinishResize()
+{
+    // Nothing to swap until background allocation is done
+    if(!pendingFields.valid() || pendingFields.wait_for(chrono::seconds(0)) != future_status::ready){
+        return false;
+    }
+    Fields newFields = pendingFields.get();
+
+    // Zero new grid split by rows as in the solvers, so each page is first touched by
+    // the thread that will use it
+    int newNx = pendingNx;
+    threadPool -> ParallelFor(0, pendingNy + 2, [&](int jStart, int jEnd){
+        newFields.ZeroFields(jStart * (newNx + 2), jEnd * (newNx + 2));
+    });
+
+    // Interpolate evolving fields, leaving step scratch and sources zeroed
+    Scalar * oldScalars[] = { fields.dens, fields.temp };
+    Scalar * newScalars[] = { newFields.dens, newFields.temp };
+    for(int f = 0; f < 2; f++){
+        Resample(newScalars[f], pendingNx, pendingNy, oldScalars[f], Nx, Ny);
+    }
+    Real * oldFields[] = { fields.xVel, fields.yVel, fields.pres, fields.pres_advect };
+    Real * newPlanes[] = { newFields.xVel, newFields.yVel, newFields.pres, newFields.pres_advect };
+    for(int f = 0; f < 4; f++){
+        Resample(newPlanes[f], pendingNx, pendingNy, oldFields[f], Nx, Ny);
+    }
+
+    // Swap grids
+    this -> Nx = pendingNx;
+    this -> Ny = pendingNy;
+    this -> size = (Nx + 2) * (Ny + 2);
+    fields = move(newFields);
+    coefficientsConstant = false;
+    mixedFieldsCurrent = false;
+
+    // Fill edges as the solvers would
+    UpdateConstants();
+    SetBoundary(params.closedBoundaries ? 0 : -1, fields.dens);
+    SetBoundary(0, fields.temp);
+    SetBoundary(params.closedBoundaries ? 1 : 0, fields.xVel);
+    SetBoundary(params.closedBoundaries ? 2 : 0, fields.yVel);
+    SetBoundary(0, fields.pres);
+    SetBoundary(0, fields.pres_advect);
+    SetConstantSource(fields.temp_prev, constants.airTemp);
+    SetConstantSource(fields.temp_source, constants.airTemp);
+
+    return true;
+}
+
+// Solver statistics from last step
+template<typename Scalar>
+SolveStats BasicSimState<Scalar>::GetSolveStats(SolveType solve) { return solveStats[solve]; }
+
+// Time step splitting accessors
+template<typename Scalar>
+int BasicSimState<Scalar>::GetSubsteps() { return substeps; }
+template<typename Scalar>
+float BasicSimState<Scalar>::GetCFL() { return cfl; }
+template<typename Scalar>
+float BasicSimState<Scalar>::GetActiveFraction()
+{
+    return float(max(0, active.iEnd - active.iStart) * max(0, active.jEnd - active.jStart)) / (Nx * Ny);
+}
+
 // Property accessors
-float * SimState::GetDensity() { return fields.dens; }
-float * SimState::GetXVelocity() { return fields.xVel; }
-float * SimState::GetYVelocity() { return fields.yVel; }
-float * SimState::GetTemperature() { return fields.temp; }
-int SimState::GetN() { return N; }
-int SimState::GetSize() { return size; }
+template<typename Scalar>
+Scalar * BasicSimState<Scalar>::GetDensity() { return fields.dens; }
+template<typename Scalar>
+typename BasicSimState<Scalar>::Real * BasicSimState<Scalar>::GetXVelocity() { return fields.xVel; }
+template<typename Scalar>
+typename BasicSimState<Scalar>::Real * BasicSimState<Scalar>::GetYVelocity() { return fields.yVel; }
+template<typename Scalar>
+Scalar * BasicSimState<Scalar>::GetTemperature() { return fields.temp; }
+
+// Mixed fluid field accessors, deriving fields with current constants if out of date
+template<typename Scalar>
+typename BasicSimState<Scalar>::Real * BasicSimState<Scalar>::GetMixedDensity()
+{
+    UpdateConstants();
+    UpdateMixedFields();
+    return fields.mixedDens;
+}
+template<typename Scalar>
+typename BasicSimState<Scalar>::Real * BasicSimState<Scalar>::GetMixedDensityAtAirTemp()
+{
+    UpdateConstants();
+    UpdateMixedFields();
+    return fields.mixedDensAtAirTemp;
+}
+template<typename Scalar>
+typename BasicSimState<Scalar>::Real * BasicSimState<Scalar>::GetMixedTemperature()
+{
+    UpdateConstants();
+    UpdateMixedFields();
+    return fields.mixedTemp;
+}
+
+// Mark mixed fluid fields out of date, after density or temperature are written directly
+template<typename Scalar>
+void BasicSimState<Scalar>::InvalidateMixedFields() { mixedFieldsCurrent = false; }
+template<typename Scalar>
+int BasicSimState<Scalar>::GetNx() { return Nx; }
+template<typename Scalar>
+int BasicSimState<Scalar>::GetNy() { return Ny; }
+template<typename Scalar>
+int BasicSimState<Scalar>::GetSize() { return size; }
 
 // Density field of mixed fluid at background temperature
-float SimState::MixedDensityAtAirTemp(int ind, SimParams params, SimFields fields)
+template<typename Scalar>
+typename BasicSimState<Scalar>::Real BasicSimState<Scalar>::MixedDensityAtAirTemp(int ind, const Constants & constants, const Fields & fields)
 {
-    return params.airDens + fields.dens[ind] * (1.0 - params.massRatio);
+    return constants.MixedDensityAtAirTemp(fields.dens[ind]);
 }
 
 // Temperature field of mixed fluid
-float SimState::MixedTemperature(int ind, SimParams params, SimFields fields)
+template<typename Scalar>
+typename BasicSimState<Scalar>::Real BasicSimState<Scalar>::MixedTemperature(int ind, const Constants & constants, const Fields & fields)
 {
-    return params.airTemp + (fields.temp[ind] - params.airTemp) * (fields.dens[ind] / MixedDensityAtAirTemp(ind, params, fields));
+    return constants.MixedTemperature(fields.dens[ind], fields.temp[ind]);
 }
 
 // Density field of mixed fluid at temperature
-float SimState::MixedDensity(int ind, SimParams params, SimFields fields)
+template<typename Scalar>
+typename BasicSimState<Scalar>::Real BasicSimState<Scalar>::MixedDensity(int ind, const Constants & constants, const Fields & fields)
 {
-    return MixedDensityAtAirTemp(ind, params, fields) * (params.airTemp / MixedTemperature(ind, params, fields));
+    return constants.MixedDensity(fields.dens[ind], fields.temp[ind]);
 }
 
 // Mass diffusivity adjusted for temperature
-float SimState::AdjustedMassDiffusivity(int ind, SimParams params, SimFields fields)
+template<typename Scalar>
+typename BasicSimState<Scalar>::Real BasicSimState<Scalar>::AdjustedMassDiffusivity(int ind, bool advanced, const Constants & constants, const Fields & fields)
 {
-    return params.advancedCoefficients
-            ? params.diff * sqrt(fields.temp[ind] / params.airTemp) * (fields.temp[ind] / params.airTemp)
-            : params.diff;
+    return advanced
+            ? AdjustedMassDiffusivity<true>(ind, constants, fields)
+            : AdjustedMassDiffusivity<false>(ind, constants, fields);
 }
 
 // Viscosity adjusted for temperature
-float SimState::AdjustedViscosity(int ind, SimParams params, SimFields fields)
+template<typename Scalar>
+typename BasicSimState<Scalar>::Real BasicSimState<Scalar>::AdjustedViscosity(int ind, bool advanced, const Constants & constants, const Fields & fields)
 {
-    return params.advancedCoefficients
-            ? params.visc * sqrt(MixedTemperature(ind, params, fields) / params.airTemp) / MixedDensityAtAirTemp(ind, params, fields)
-            : params.visc;
+    return advanced
+            ? constants.visc * sqrt(MixedTemperature(ind, constants, fields) / constants.airTemp) / MixedDensityAtAirTemp(ind, constants, fields)
+            : constants.visc;
 }
 
 // Thermal diffusivity adjusted for temperature
-float SimState::AdjustedThermalDiffusivity(int ind, SimParams params, SimFields fields)
+template<typename Scalar>
+typename BasicSimState<Scalar>::Real BasicSimState<Scalar>::AdjustedThermalDiffusivity(int ind, bool advanced, const Constants & constants, const Fields & fields)
 {
-    return params.advancedCoefficients
-            ? params.diffTemp * sqrt(fields.temp[ind] / params.airTemp)
-            : params.diffTemp;
+    return advanced
+            ? AdjustedThermalDiffusivity<true>(ind, constants, fields)
+            : AdjustedThermalDiffusivity<false>(ind, constants, fields);
 }
 
 
 //// SIMSTATE PRIVATE METHODS ////
 
 // Set array values to those of other array
-void SimState::SetSource(float * x, float * x_set)
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::SetSource(T * x, T * x_set)
 {
     // Set array values at each cell
     for(int i = 0; i < size; i++){
@@ -190,306 +443,1318 @@ void SimState::SetSource(float * x, float * x_set)
 }
 
 // Set array values to constant source value
-void SimState::SetConstantSource(float * x, float x_set)
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::SetConstantSource(T * x, Real x_set)
 {
-    // Set array values at each cell
-    for(int i = 0; i < size; i++){
-        x[i] = x_set;
-    }
+    // Set array values at each cell, split by rows as in the solvers so fresh
+    // pages are first touched by the threads that will use them
+    threadPool -> ParallelFor(0, Ny + 2, [&](int jStart, int jEnd){
+        for(int i = ind(0,jStart); i < ind(0,jEnd); i++){
+            x[i] = x_set;
+        }
+    });
 }
 
 // Add source values into array values
-void SimState::AddSource(float * x, float * s, float dt)
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::AddSource(T * x, T * s, float dt)
 {
     // Loop through grid elements
-    for(int i = 0; i < size; i++){
-        x[i] += dt * s[i];
-    }
+    ForActiveCells([&](int i){
+        x[i] = x[i] + dt * s[i];
+    });
 }
 
 // Add heat source via maximum temp (could use revision)
-void SimState::AddHeatSource(float * t, float * s)
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::AddHeatSource(T * t, T * s)
 {
     // Loop through grid elements
-    for(int i = 0; i < size; i++){
+    ForActiveCells([&](int i){
         t[i] = max(t[i], s[i]);
-    }
+    });
 }
 
 // Add constant source value into array values
-void SimState::AddConstantSource(float * x, float s, float dt)
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::AddConstantSource(T * x, float s, float dt)
 {
     // Loop through grid elements
-    for(int i = 0; i < size; i++){
-        x[i] += dt * s;
-    }
+    ForActiveCells([&](int i){
+        x[i] = x[i] + dt * s;
+    });
 }
 
 // Evaluate boundary conditions
-void SimState::SetBoundary(int b, float * x)
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::SetBoundary(int b, T * x)
 {
-    float xMod, yMod;
+    if(heldSides != allSides){
+        SetBoundary(b, x, Nx, Ny);
+    }
 
+    // Held ghost cells are restored as the step started, if saved for the field
+    if(heldSides){
+        std::vector<T> * ghosts = HeldGhosts(x);
+        if(ghosts && (int)ghosts -> size() == 2 * (Nx + Ny) + 4){
+            CopyGhosts(x, ghosts -> data(), false);
+        }
+    }
+}
+
+// Evaluate boundary conditions on grid of given size
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::SetBoundary(int b, T * x, int Nx, int Ny)
+{
     switch(b){
-        case -1: xMod =  0.; yMod =  0.; break;
-        case  0: xMod =  1.; yMod =  1.; break;
-        case  1: xMod = -1.; yMod =  1.; break;
-        case  2: xMod =  1.; yMod = -1.; break;
+        case -1: SetBoundary<-1>(x, Nx, Ny); break;
+        case  0: SetBoundary< 0>(x, Nx, Ny); break;
+        case  1: SetBoundary< 1>(x, Nx, Ny); break;
+        case  2: SetBoundary< 2>(x, Nx, Ny); break;
     }
+}
 
-    for(int i = 1; i <= N; i++){
-        x[ind(0,  i)] = xMod * x[ind(1,i)];
-        x[ind(N+1,i)] = xMod * x[ind(N,i)];
-        x[ind(i,  0)] = yMod * x[ind(i,1)];
-        x[ind(i,N+1)] = yMod * x[ind(i,N)];
+// Evaluate boundary conditions of fixed type on grid of given size
+template<typename Scalar>
+template<int b, typename T>
+void BasicSimState<Scalar>::SetBoundary(T * x, int Nx, int Ny)
+{
+    // Reflection factors across vertical and horizontal walls
+    const float xMod = b == -1 ? 0. : (b == 1 ? -1. : 1.);
+    const float yMod = b == -1 ? 0. : (b == 2 ? -1. : 1.);
+
+    for(int j = 1; j <= Ny; j++){
+        x[ind(0,   j)] = xMod * x[ind(1, j)];
+        x[ind(Nx+1,j)] = xMod * x[ind(Nx,j)];
+    }
+    for(int i = 1; i <= Nx; i++){
+        x[ind(i,   0)] = yMod * x[ind(i,1)];
+        x[ind(i,Ny+1)] = yMod * x[ind(i,Ny)];
     }
 
-    x[ind(0,    0)] = 0.5 * (x[ind(1,  0)] + x[ind(0,  1)]);
-    x[ind(0,  N+1)] = 0.5 * (x[ind(1,N+1)] + x[ind(0,  N)]);
-    x[ind(N+1,  0)] = 0.5 * (x[ind(N,  0)] + x[ind(N+1,1)]);
-    x[ind(N+1,N+1)] = 0.5 * (x[ind(N,N+1)] + x[ind(N+1,N)]);
+    SetCorners(x, Nx, Ny);
+}
+
+// Save ghost cells of density, temperature, velocity and pressure as the caller set them
+template<typename Scalar>
+void BasicSimState<Scalar>::HoldBoundaries()
+{
+    int ring = 2 * (Nx + Ny) + 4;
+    heldDens.resize(ring);
+    heldTemp.resize(ring);
+    heldXVel.resize(ring);
+    heldYVel.resize(ring);
+    heldPres.resize(ring);
+    heldPresAdvect.resize(ring);
+
+    CopyGhosts(fields.dens, heldDens.data(), true);
+    CopyGhosts(fields.temp, heldTemp.data(), true);
+    CopyGhosts(fields.xVel, heldXVel.data(), true);
+    CopyGhosts(fields.yVel, heldYVel.data(), true);
+    CopyGhosts(fields.pres, heldPres.data(), true);
+    CopyGhosts(fields.pres_advect, heldPresAdvect.data(), true);
+}
+
+// Saved ghost cells of the field x or its previous values belong to, if any
+template<typename Scalar>
+template<typename T>
+std::vector<T> * BasicSimState<Scalar>::HeldGhosts(T * x)
+{
+    if constexpr(is_same<T, Scalar>::value){
+        if(x == fields.dens || x == fields.dens_prev) return &heldDens;
+        if(x == fields.temp || x == fields.temp_prev) return &heldTemp;
+    }
+    if constexpr(is_same<T, Real>::value){
+        if(x == fields.xVel || x == fields.xVel_prev) return &heldXVel;
+        if(x == fields.yVel || x == fields.yVel_prev) return &heldYVel;
+        if(x == fields.pres) return &heldPres;
+        if(x == fields.pres_advect) return &heldPresAdvect;
+    }
+    return nullptr;
+}
+
+// Copy ghost cells of x into ghosts if store is set, or back from them on held sides
+// otherwise, bottom and top rows first, then the left and right columns between them
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::CopyGhosts(T * x, T * ghosts, bool store)
+{
+    int n = 0;
+    auto copy = [&](int c, int sides){
+        if(store){
+            ghosts[n] = x[c];
+        }else if(heldSides & sides){
+            x[c] = ghosts[n];
+        }
+        n++;
+    };
+    for(int i = 0; i <= Nx + 1; i++){
+        int ends = (i == 0 ? leftSide : 0) | (i == Nx + 1 ? rightSide : 0);
+        copy(ind(i,0), bottomSide | ends);
+        copy(ind(i,Ny+1), topSide | ends);
+    }
+    for(int j = 1; j <= Ny; j++){
+        copy(ind(0,j), leftSide);
+        copy(ind(Nx+1,j), rightSide);
+    }
+}
+
+// Evaluate boundary conditions of fixed type next to one finished row of region: side
+// walls of the row and, after the first or last row, the bottom or top wall, where the
+// region reaches them. Only the row itself reads these ghost cells, so sweeps calling
+// this as each row is done see them just as after SetBoundary between sweeps, without
+// another pass down the columns of the grid
+template<typename Scalar>
+template<int b, typename T>
+void BasicSimState<Scalar>::SetRowBoundary(T * x, int Nx, int Ny, const CellRegion & region, int j)
+{
+    // Reflection factors across vertical and horizontal walls
+    const float xMod = b == -1 ? 0. : (b == 1 ? -1. : 1.);
+    const float yMod = b == -1 ? 0. : (b == 2 ? -1. : 1.);
+
+    if(region.iStart == 1){
+        x[ind(0,   j)] = xMod * x[ind(1, j)];
+    }
+    if(region.iEnd == Nx + 1){
+        x[ind(Nx+1,j)] = xMod * x[ind(Nx,j)];
+    }
+    if(j == 1){
+        for(int i = region.iStart; i < region.iEnd; i++){
+            x[ind(i,0)] = yMod * x[ind(i,1)];
+        }
+    }
+    if(j == Ny){
+        for(int i = region.iStart; i < region.iEnd; i++){
+            x[ind(i,Ny+1)] = yMod * x[ind(i,Ny)];
+        }
+    }
+}
+
+// Average corner ghost cells from their neighboring ghost cells
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::SetCorners(T * x, int Nx, int Ny)
+{
+    x[ind(0,     0)] = 0.5 * (x[ind(1,   0)] + x[ind(0,   1)]);
+    x[ind(0,  Ny+1)] = 0.5 * (x[ind(1,Ny+1)] + x[ind(0,  Ny)]);
+    x[ind(Nx+1,  0)] = 0.5 * (x[ind(Nx,  0)] + x[ind(Nx+1,1)]);
+    x[ind(Nx+1,Ny+1)] = 0.5 * (x[ind(Nx,Ny+1)] + x[ind(Nx+1,Ny)]);
 }
 
 // Improved diffusion
-void SimState::Diffuse(int b, float * x, float * x0, float (*diff)(int, SimParams, SimFields), float dt)
+template<typename Scalar>
+template<int b, typename T>
+void BasicSimState<Scalar>::Diffuse(T * x, T * x0, Real * coeff, float dt, SolveType solve)
 {
     // Adjust a to account for cell size and timestep
-    float cellSize = params.lengthScale / N;
+    float cellSize = params.lengthScale / Nx;
     float a = dt / (cellSize * cellSize);
 
-    // Loop through Gauss-Seidel relaxation steps
-    for(int k = 0; k < params.solverSteps; k++){
+    // Conjugate gradient solve to tolerance, for single simulations only
+    if constexpr(is_same<Real, float>::value){
+        if(params.diffusionSolver == SimParams::conjugateGradient){
+            UpdateConjugateGradient();
+            float * shift = conjugateGradient -> Shift();
+            float * rhs = conjugateGradient -> Rhs();
+
+            // Solve in place, or in a float plane for fields stored otherwise
+            float * solution;
+            if constexpr(is_same<T, float>::value){
+                solution = x;
+            }else{
+                solveScratch.resize(size);
+                solution = solveScratch.data();
+            }
 
-        // Loop through grid elements
-        for(int i = 1; i <= N; i++){
-            for(int j = 1; j <= N; j++){
+            // Start from undiffused field
+            for(int i = 0; i < size; i++){
+                solution[i] = x0[i];
+            }
 
-                // Adjust for temperature and density using passed-in function
-                float a_t = a * diff(ind(i,j), params, fields);
+            // Divide each row by its coefficient to make the system symmetric
+            for(int j = 1; j <= Ny; j++){
+                for(int i = 1; i <= Nx; i++){
+                    float a_t = max(a * coeff[ind(i,j)], 1e-12f);
+                    shift[ind(i,j)] = 1 / a_t;
+                    rhs[ind(i,j)] = x0[ind(i,j)] / a_t;
+                }
+            }
+            int iterations = conjugateGradient -> Solve(b, solution, rhs, shift, params.solverTolerance, params.solverMaxIterations);
+            RecordSolve(solve, iterations, conjugateGradient -> LastResidual());
+
+            // Store solution back at field precision
+            if constexpr(!is_same<T, float>::value){
+                for(int i = 0; i < size; i++){
+                    x[i] = solution[i];
+                }
+            }
+            return;
+        }
+    }
+
+    // Start from undiffused field when checking residuals, so calm fields converge at once
+    bool checkResidual = params.residualCheckInterval > 0;
+    float residual = -1;
+    double rhsNorm = 0;
+    if(checkResidual){
+        for(int i = 0; i < size; i++){
+            x[i] = x0[i];
+        }
+        rhsNorm = sqrt(RowSum<double>([&](int j){
+            double sum = 0;
+            for(int i = 1; i <= Nx; i++){
+                sum += SumSquares(x0[ind(i,j)]);
+            }
+            return sum;
+        }));
+    }
+
+    // Held ghost cells of the field bound the solve
+    if(heldSides){
+        SetBoundary(b, x);
+    }
+
+    // Loop through Gauss-Seidel relaxation steps over the whole grid, as pressure is
+    // solved, since an implicit solve spreads past any margin of the active region
+    int k, sweeps;
+    for(k = 0; k < params.solverSteps; k += sweeps){
+
+        // Measure residual every few sweeps and stop once converged
+        if(checkResidual && k % params.residualCheckInterval == 0){
+            residual = DiffusionResidual(x, x0, coeff, a, rhsNorm);
+            if(residual <= params.solverTolerance){
+                break;
+            }
+        }
+
+        // Sweeps applied together in this pass
+        sweeps = SweepsPerPass(k, params.diffusionSolver);
+
+        // Sweep each color in parallel, or whole grid in order
+        if(params.diffusionSolver == SimParams::redBlack){
+            DiffuseRedBlack<b>(x, x0, coeff, a, 0);
+            DiffuseRedBlack<b>(x, x0, coeff, a, 1);
+        }else{
+
+            // Relax one grid element
+            auto relax = [&](int i, int j){
+
+                // Adjust for temperature and density using precomputed coefficients
+                Real a_t = a * coeff[ind(i,j)];
 
                 // Diffusion step
                 x[ind(i,j)] = (x0[ind(i,j)] + 
                 a_t*(x[ind(i-1,j)] + x[ind(i+1,j)] + x[ind(i,j-1)] + x[ind(i,j+1)])) / (1 + 4*a_t);
+            };
+
+            // Loop through grid elements as a wavefront of sweeps, or tile by tile
+            if(sweeps > 1){
+                SweepWavefront<b>(x, {1, Nx + 1, 1, Ny + 1}, sweeps, relax);
+            }else{
+                SweepTiles<b>(x, {1, Nx + 1, 1, Ny + 1}, relax);
             }
         }
-        SetBoundary(b, x);
+
+        // Sweeps leave held ghost cells alone, so walls of other sides follow each pass
+        if(heldSides){
+            SetBoundary(b, x);
+        }
+    }
+    if(k > 0 && !heldSides){
+        SetCorners(x, Nx, Ny);
+    }
+
+    // Measure final residual if all steps were taken
+    if(checkResidual && k == params.solverSteps){
+        residual = DiffusionResidual(x, x0, coeff, a, rhsNorm);
     }
+    RecordSolve(solve, k, residual);
+}
+
+// Norm of diffusion residual relative to source field norm
+template<typename Scalar>
+template<typename T>
+float BasicSimState<Scalar>::DiffusionResidual(T * x, T * x0, Real * coeff, float a, double rhsNorm)
+{
+    double resNorm = sqrt(RowSum<double>([&](int j){
+        double sum = 0;
+        for(int i = 1; i <= Nx; i++){
+            Real a_t = a * coeff[ind(i,j)];
+            Real r = x0[ind(i,j)] - (1 + 4*a_t) * x[ind(i,j)] +
+                     a_t*(x[ind(i-1,j)] + x[ind(i+1,j)] + x[ind(i,j-1)] + x[ind(i,j+1)]);
+            sum += SumSquares(r);
+        }
+        return sum;
+    }));
+
+    return rhsNorm > 0 ? resNorm / rhsNorm : resNorm;
+}
+
+// Diffusion relaxation over cells of one checkerboard color
+template<typename Scalar>
+template<int b, typename T>
+void BasicSimState<Scalar>::DiffuseRedBlack(T * x, T * x0, Real * coeff, float a, int color)
+{
+    // Cells of one color only read cells of the other, so rows are independent, and
+    // rows are done after the second color, so their ghost cells are refreshed then
+    threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            for(int i = 1 + (1 + j + color) % 2; i <= Nx; i += 2){
+
+                // Adjust for temperature and density using precomputed coefficients
+                Real a_t = a * coeff[ind(i,j)];
+
+                // Diffusion step
+                x[ind(i,j)] = (x0[ind(i,j)] + 
+                a_t*(x[ind(i-1,j)] + x[ind(i+1,j)] + x[ind(i,j-1)] + x[ind(i,j+1)])) / (1 + 4*a_t);
+            }
+            if(color == 1 && !heldSides){
+                SetRowBoundary<b>(x, Nx, Ny, {1, Nx + 1, 1, Ny + 1}, j);
+            }
+        }
+    });
 }
 
 // Dissipate density
-void SimState::Dissipate(float * x, float eqVal, float rate, float dt)
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::Dissipate(T * x, Real eqVal, Real rate, float dt)
 {
     // Adjust for time scale
-    float d = rate * dt;
+    Real d = rate * dt;
 
     // Loop through grid elements
-    for(int i = 0; i < size; i++){
+    ForActiveCells([&](int i){
 
         // Decay temperatures
-        x[i] -= d * (x[i] - eqVal);
-    }
+        x[i] = x[i] - d * (x[i] - eqVal);
+    });
 }
 
 // Dissipate density based on temperature
-void SimState::DissipateWithFallOff(float * x, float eqVal, float rate, float fallOff, float dt)
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::DissipateWithFallOff(T * x, Real eqVal, Real rate, Real fallOff, float dt)
 {
     // Adjust for time scale
-    float d = rate * dt;
+    Real d = rate * dt;
 
     // Loop through grid elements
-    for(int i = 0; i < size; i++){
+    ForActiveCells([&](int i){
 
         // Decay temperatures
-        x[i] -= d * (1. - fallOff * (fields.temp[i] - params.airTemp)) * (x[i] - eqVal) ;
-    }
+        x[i] = x[i] - d * (1. - fallOff * (fields.temp[i] - constants.airTemp)) * (x[i] - eqVal) ;
+    });
 }
 
-// Perform advection step
-void SimState::Advect(int b, float * d, float * d0, float * u, float * v, float dt)
+// Advect fields along the same velocity, sharing departure points
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::AdvectFields(T ** d, T ** d0, int count, Real * u, Real * v, float dt)
 {
-    int i0, j0, i1, j1;
-    float x, y, s0, t0, s1, t1;
-    
+    // Vector kernel for this CPU, chosen on first use
+    static const AdvectRowsKernel advectRows = SelectAdvectRows();
+
     // Adjust dt to account for cell size
-    float cellSize = params.lengthScale / N;
+    float cellSize = params.lengthScale / Nx;
     float dt0 = dt / cellSize;
 
-    // Loop through grid elements
-    for(int i = 1; i <= N; i++){
-        for(int j = 1; j <= N; j++){
+    // Cells outside the active region keep their previous values
+    if(activePartial){
+        for(int f = 0; f < count; f++){
+            CopyOutsideRegion(d[f], d0[f]);
+        }
+    }
 
-            // Calculate origin coordinates
-            x = i - dt0 * u[ind(i,j)];
-            y = j - dt0 * v[ind(i,j)];
+    // Each cell reads only the previous field, so rows are independent; vector
+    // kernels gather float samples, so other precisions interpolate cell by cell
+    // and ensembles lane by lane
+    int iStart = active.iStart, iEnd = active.iEnd;
+    threadPool -> ParallelFor(active.jStart, active.jEnd, [&](int jStart, int jEnd){
+        if constexpr(is_same<T, float>::value){
+            advectRows(d, d0, count, u, v, dt0, Nx, Ny, iStart, iEnd, jStart, jEnd);
+        }else if constexpr(FieldTypes<T>::lanes > 1){
+            AdvectRowsLanes(d, d0, count, u, v, dt0, Nx, Ny, iStart, iEnd, jStart, jEnd);
+        }else{
+            AdvectRowsScalar(d, d0, count, u, v, dt0, Nx, Ny, iStart, iEnd, jStart, jEnd);
+        }
+    });
+}
 
-            // Discretize into adjacent grid elements
-            if(x <     0.5) { x =     0.5; }
-            if(x > N + 0.5) { x = N + 0.5; }
-            i0 = (int)x;
-            i1 = i0 + 1;
+// Advect fields by the chosen scheme. MacCormack and BFECC advect the result back again
+// to estimate the error of the first pass, then correct by half of it (MacCormack) or
+// advect again from a corrected start (BFECC); either is limited to the samples of the
+// first pass so no new extrema appear. Ghost cells of d use boundary types b
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::AdvectFieldsByScheme(SimParams::AdvectionScheme scheme, T ** d, T ** d0, int count,
+                                                 const int * b, Real * u, Real * v, float dt)
+{
+    // Forward pass, which is the result for semi-Lagrangian advection
+    AdvectFields(d, d0, count, u, v, dt);
+    if(scheme == SimParams::semiLagrangian){
+        return;
+    }
 
-            if(y <     0.5) { y =     0.5; }
-            if(y > N + 0.5) { y = N + 0.5; }
-            j0 = (int)y;
-            j1 = j0 + 1;
+    // Intermediate planes of each field, in the storage type of the fields
+    T * scratch;
+    if constexpr(is_same<T, Real>::value){
+        realAdvectScratch.resize(2 * count * size);
+        scratch = realAdvectScratch.data();
+    }else{
+        scalarAdvectScratch.resize(2 * count * size);
+        scratch = scalarAdvectScratch.data();
+    }
+    std::vector<T *> back(count), corrected(count);
+    for(int f = 0; f < count; f++){
+        back[f] = scratch + 2 * f * size;
+        corrected[f] = scratch + (2 * f + 1) * size;
+    }
 
-            s1 = x - i0;
-            s0 = 1 - s1;
-            t1 = y - j0;
-            t0 = 1 - t1;
+    // Backward pass from forward result, whose difference from start is twice the error
+    for(int f = 0; f < count; f++){
+        SetBoundary(b[f], d[f]);
+    }
+    AdvectFields(back.data(), d, count, u, v, -dt);
+
+    // Correct forward result, or start, by half the difference
+    T ** target = scheme == SimParams::macCormack ? d : corrected.data();
+    threadPool -> ParallelFor(active.jStart, active.jEnd, [&](int jStart, int jEnd){
+        for(int f = 0; f < count; f++){
+            T * base = scheme == SimParams::macCormack ? d[f] : d0[f];
+            for(int j = jStart; j < jEnd; j++){
+                for(int i = active.iStart; i < active.iEnd; i++){
+                    target[f][ind(i,j)] = base[ind(i,j)] + 0.5f * (d0[f][ind(i,j)] - back[f][ind(i,j)]);
+                }
+            }
+        }
+    });
 
-            // Calculate new value due to advection
-            d[ind(i,j)] = s0 * (t0 * d0[ind(i0,j0)] + t1 * d0[ind(i0,j1)]) +
-                          s1 * (t0 * d0[ind(i1,j0)] + t1 * d0[ind(i1,j1)]);
+    // Advect corrected start for BFECC
+    if(scheme == SimParams::bfecc){
+        for(int f = 0; f < count; f++){
+            if(activePartial){
+                CopyOutsideRegion(corrected[f], d0[f]);
+            }
+            SetBoundary(b[f], corrected[f]);
         }
+        AdvectFields(d, corrected.data(), count, u, v, dt);
     }
-    SetBoundary(b, d);
+
+    ClampAdvected(d, d0, count, u, v, dt);
+}
+
+// Clamp advected fields to the samples their departure points interpolate from
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::ClampAdvected(T ** d, T ** d0, int count, Real * u, Real * v, float dt)
+{
+    // Adjust dt to account for cell size
+    float cellSize = params.lengthScale / Nx;
+    float dt0 = dt / cellSize;
+
+    int iStart = active.iStart, iEnd = active.iEnd;
+    threadPool -> ParallelFor(active.jStart, active.jEnd, [&](int jStart, int jEnd){
+        if constexpr(FieldTypes<T>::lanes > 1){
+            ClampRowsLanes(d, d0, count, u, v, dt0, Nx, Ny, iStart, iEnd, jStart, jEnd);
+        }else{
+            ClampRowsScalar(d, d0, count, u, v, dt0, Nx, Ny, iStart, iEnd, jStart, jEnd);
+        }
+    });
 }
 
 // Perform Hodge Projection for advection
-void SimState::HodgeProjection(float * u, float * v, float * p, float * div)
+template<typename Scalar>
+void BasicSimState<Scalar>::HodgeProjection(Real * u, Real * v, Real * p, Real * div)
 {
     // Adjust for cell size
-    float cellSize = params.lengthScale / N;
-
-    // Calculate divergence in each grid element 
-    for(int i = 1; i <= N; i++){
-        for(int j = 1; j <= N; j++){
-            div[ind(i,j)] = -0.5 * cellSize * (u[ind(i+1,j)]-u[ind(i-1,j)]+
-                                        v[ind(i,j+1)]-v[ind(i,j-1)]);
-            p[ind(i,j)] = 0;
+    float cellSize = params.lengthScale / Nx;
+
+    // Calculate divergence in each grid element, row by row
+    threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            for(int i = 1; i <= Nx; i++){
+                div[ind(i,j)] = -0.5 * cellSize * (u[ind(i+1,j)]-u[ind(i-1,j)]+
+                                            v[ind(i,j+1)]-v[ind(i,j-1)]);
+            }
         }
-    }
+    });
     SetBoundary(0, div);
+
+    // Seed with last solution, or start from zero
+    if(!params.warmStartPressure){
+        SetConstantSource(p, 0.0);
+    }
     SetBoundary(0, p);
 
+    // Multigrid and conjugate gradient solve single simulations, while ensembles relax
+    if constexpr(is_same<Real, float>::value){
+
+        // Multigrid cycles for divergence
+        if(params.pressureSolver == SimParams::multigrid){
+
+            // Rebuild hierarchy if grid or thread pool changed
+            if(multigrid == nullptr || multigrid -> GetNx() != Nx || multigrid -> GetNy() != Ny){
+                delete multigrid;
+                multigrid = new Multigrid(Nx, Ny, threadPool);
+            }
+            float tolerance = params.residualCheckInterval > 0 ? params.solverTolerance : 0;
+            int cycles = multigrid -> Solve(p, div, params.multigridCycles, tolerance, !params.warmStartPressure);
+            RecordSolve(pressureSolve, cycles, multigrid -> LastResidual());
+
+        }else if(params.pressureSolver == SimParams::conjugateGradient){
+
+            // Conjugate gradient solve to tolerance
+            UpdateConjugateGradient();
+            int iterations = conjugateGradient -> Solve(0, p, div, nullptr, params.solverTolerance, params.solverMaxIterations);
+            RecordSolve(pressureSolve, iterations, conjugateGradient -> LastResidual());
+
+        }else{
+            RelaxPressure(p, div);
+        }
+    }else{
+        RelaxPressure(p, div);
+    }
+
+    // Keep warm-started pressure centered, as only its gradient matters, unless held
+    // ghost cells fix its level
+    if(params.warmStartPressure && !heldSides){
+        RemoveMean(p);
+    }
+
+    // Calculate divergence-free Hodge projection in each grid element, row by row
+    threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            for(int i = 1; i <= Nx; i++){
+                u[ind(i,j)] -= 0.5 * (p[ind(i+1,j)] - p[ind(i-1,j)]) / cellSize;
+                v[ind(i,j)] -= 0.5 * (p[ind(i,j+1)] - p[ind(i,j-1)]) / cellSize;
+            }
+        }
+    });
+    SetBoundary(1, u);
+    SetBoundary(2, v);
+}
+
+// Relax pressure toward solution for divergence by Gauss-Seidel or red-black sweeps
+template<typename Scalar>
+void BasicSimState<Scalar>::RelaxPressure(Real * p, Real * div)
+{
+    // Source norm for relative residual
+    bool checkResidual = params.residualCheckInterval > 0;
+    float residual = -1;
+    double rhsNorm = 0;
+    if(checkResidual){
+        rhsNorm = sqrt(RowSum<double>([&](int j){
+            double sum = 0;
+            for(int i = 1; i <= Nx; i++){
+                sum += SumSquares(div[ind(i,j)]);
+            }
+            return sum;
+        }));
+    }
+
     // Gauss-Seidel relaxation for divergence
-    for(int k = 0; k < params.solverSteps; k++){
-        for(int i = 1; i <= N; i++){
-            for(int j = 1; j <= N; j++){
+    int k, sweeps;
+    for(k = 0; k < params.solverSteps; k += sweeps){
+
+        // Measure residual every few sweeps and stop once converged
+        if(checkResidual && k % params.residualCheckInterval == 0){
+            residual = PressureResidual(p, div, rhsNorm);
+            if(residual <= params.solverTolerance){
+                break;
+            }
+        }
+        sweeps = SweepsPerPass(k, params.pressureSolver);
+
+        if(params.pressureSolver == SimParams::redBlack){
+            ProjectRedBlack(p, div, 0);
+            ProjectRedBlack(p, div, 1);
+        }else{
+            auto relax = [&](int i, int j){
                 p[ind(i,j)] = (div[ind(i,j)] + p[ind(i-1,j)] + p[ind(i+1,j)] +
                                                p[ind(i,j-1)] + p[ind(i,j+1)])/4;
+            };
+
+            if(sweeps > 1){
+                SweepWavefront<0>(p, {1, Nx + 1, 1, Ny + 1}, sweeps, relax);
+            }else{
+                SweepTiles<0>(p, {1, Nx + 1, 1, Ny + 1}, relax);
             }
         }
-        SetBoundary(0, p);
+        if(heldSides){
+            SetBoundary(0, p);
+        }
     }
 
-    // Calculate divergence-free Hodge projection in each grid element 
-    for(int i = 1; i <= N; i++){
-        for(int j = 1; j <= N; j++){
-            u[ind(i,j)] -= 0.5 * (p[ind(i+1,j)] - p[ind(i-1,j)]) / cellSize;
-            v[ind(i,j)] -= 0.5 * (p[ind(i,j+1)] - p[ind(i,j-1)]) / cellSize;
+    // Sweeps refresh edge ghost cells as they go, leaving the corners
+    if(k > 0 && !heldSides){
+        SetCorners(p, Nx, Ny);
+    }
+
+    // Measure final residual if all steps were taken
+    if(checkResidual && k == params.solverSteps){
+        residual = PressureResidual(p, div, rhsNorm);
+    }
+    RecordSolve(pressureSolve, k, residual);
+}
+
+// Pressure relaxation over cells of one checkerboard color
+template<typename Scalar>
+void BasicSimState<Scalar>::ProjectRedBlack(Real * p, Real * div, int color)
+{
+    threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            for(int i = 1 + (j + color + 1) % 2; i <= Nx; i += 2){
+                p[ind(i,j)] = (div[ind(i,j)] + p[ind(i-1,j)] + p[ind(i+1,j)] +
+                                               p[ind(i,j-1)] + p[ind(i,j+1)])/4;
+            }
+            if(color == 1 && !heldSides){
+                SetRowBoundary<0>(p, Nx, Ny, {1, Nx + 1, 1, Ny + 1}, j);
+            }
         }
+    });
+}
+
+// Norm of pressure residual relative to divergence norm
+template<typename Scalar>
+float BasicSimState<Scalar>::PressureResidual(Real * p, Real * div, double rhsNorm)
+{
+    double resNorm = sqrt(RowSum<double>([&](int j){
+        double sum = 0;
+        for(int i = 1; i <= Nx; i++){
+            Real r = div[ind(i,j)] - 4 * p[ind(i,j)] + p[ind(i-1,j)] + p[ind(i+1,j)] +
+                                                       p[ind(i,j-1)] + p[ind(i,j+1)];
+            sum += SumSquares(r);
+        }
+        return sum;
+    }));
+
+    return rhsNorm > 0 ? resNorm / rhsNorm : resNorm;
+}
+
+// Subtract average over interior cells from field, including ghost cells
+template<typename Scalar>
+void BasicSimState<Scalar>::RemoveMean(Real * x)
+{
+    Real mean = Real(RowSum<Sum>([&](int j){
+        Sum sum = 0;
+        for(int i = 1; i <= Nx; i++){
+            sum += Sum(x[ind(i,j)]);
+        }
+        return sum;
+    }) / (Nx * Ny));
+
+    for(int i = 0; i < size; i++){
+        x[i] -= mean;
     }
-    SetBoundary(1, u);
-    SetBoundary(2, v);
 }
 
-// Perform thermal and gravitational convection
-void SimState::Convect(float * v, float dt)
+// Bilinearly interpolate interior of field x0 on grid of Nx0 by Ny0 onto x on grid of Nx by Ny
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::Resample(T * x, int Nx, int Ny, T * x0, int Nx0, int Ny0)
 {
-    // Adjust for time scale
-    float g = dt * params.grav;
+    // Map cell centers between grids covering the same domain
+    float xScale = float(Nx0) / Nx;
+    float yScale = float(Ny0) / Ny;
+
+    threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            for(int i = 1; i <= Nx; i++){
+
+                // Position in source grid, clamped inside its ghost layer
+                float x0Pos = min(max((i - 0.5f) * xScale + 0.5f, 0.5f), Nx0 + 0.5f);
+                float y0Pos = min(max((j - 0.5f) * yScale + 0.5f, 0.5f), Ny0 + 0.5f);
+                int i0 = (int)x0Pos;
+                int j0 = (int)y0Pos;
+                float s1 = x0Pos - i0;
+                float t1 = y0Pos - j0;
+
+                // Sample surrounding cells
+                int k = i0 + (Nx0 + 2) * j0;
+                x[ind(i,j)] = (1 - s1) * ((1 - t1) * x0[k] + t1 * x0[k + Nx0 + 2]) +
+                                    s1 * ((1 - t1) * x0[k + 1] + t1 * x0[k + Nx0 + 3]);
+            }
+        }
+    });
+}
 
-    // Loop through grid elements
-    for(int i = 1; i <= N; i++){
-        for(int j = 1; j <= N; j++){
+// Sum per-row values over interior rows, adding rows in order for reproducibility
+template<typename Scalar>
+template<typename V>
+V BasicSimState<Scalar>::RowSum(const std::function<V(int)> & rowValue)
+{
+    std::vector<V> sums(Ny + 2, V(0.0));
+    threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            sums[j] = rowValue(j);
+        }
+    });
 
-            // Calculate thermal buoyancy values
-            float density;
-            if(params.temperatureOn){
-                density = MixedDensity(ind(i,j), params, fields);
-            }else{
-                density = MixedDensityAtAirTemp(ind(i,j), params, fields);
+    V sum = 0;
+    for(int j = 1; j <= Ny; j++){
+        sum += sums[j];
+    }
+    return sum;
+}
+
+// Fill viscosity and mass diffusivity fields for this step
+template<typename Scalar>
+template<bool advanced>
+void BasicSimState<Scalar>::UpdateCoefficients()
+{
+    // Constant coefficients only need refilling when parameters change
+    if(!advanced){
+        if(coefficientsConstant
+        && All(coefficientConstants.visc == constants.visc)
+        && All(coefficientConstants.diff == constants.diff)
+        && All(coefficientConstants.diffTemp == constants.diffTemp)){
+            return;
+        }
+
+        SetConstantSource(fields.visc_coeff, constants.visc);
+        SetConstantSource(fields.diff_coeff, constants.diff);
+        SetConstantSource(fields.diffTemp_coeff, constants.diffTemp);
+        coefficientConstants = constants;
+        coefficientsConstant = true;
+        return;
+    }
+    coefficientsConstant = false;
+
+    // Adjust each cell for temperature and density
+    threadPool -> ParallelFor(0, Ny + 2, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            for(int i = 0; i <= Nx + 1; i++){
+                fields.visc_coeff[ind(i,j)] = AdjustedViscosity<advanced>(ind(i,j), constants, fields);
+                fields.diff_coeff[ind(i,j)] = AdjustedMassDiffusivity<advanced>(ind(i,j), constants, fields);
+            }
+        }
+    });
+}
+
+// Fill thermal diffusivity field for this step
+template<typename Scalar>
+template<bool advanced>
+void BasicSimState<Scalar>::UpdateThermalCoefficients()
+{
+    // Constant coefficients are filled with the others
+    if(!advanced){
+        return;
+    }
+
+    // Adjust each cell for temperature
+    threadPool -> ParallelFor(0, Ny + 2, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            for(int i = 0; i <= Nx + 1; i++){
+                fields.diffTemp_coeff[ind(i,j)] = AdjustedThermalDiffusivity<advanced>(ind(i,j), constants, fields);
             }
+        }
+    });
+}
 
-            // Calculate buoyant force
-            float bForce;
-            if(density == 0.0){
-                bForce = 1.0;
-            }else{
-                bForce = (density - params.airDens) / density;
+// Derive mixed fluid fields of every cell from density and temperature, unless already
+// derived from them with the same constants
+template<typename Scalar>
+void BasicSimState<Scalar>::UpdateMixedFields()
+{
+    if(mixedFieldsCurrent
+    && All(mixedConstants.airDens == constants.airDens)
+    && All(mixedConstants.massRatio == constants.massRatio)
+    && All(mixedConstants.airTemp == constants.airTemp)){
+        return;
+    }
+
+    // Each step of MixedDensity, evaluated once per cell
+    threadPool -> ParallelFor(0, Ny + 2, [&](int jStart, int jEnd){
+        for(int k = ind(0,jStart); k < ind(0,jEnd); k++){
+            Real atAirTemp = constants.MixedDensityAtAirTemp(fields.dens[k]);
+            Real mixedTemp = constants.MixedTemperature(fields.dens[k], fields.temp[k]);
+            fields.mixedDensAtAirTemp[k] = atAirTemp;
+            fields.mixedTemp[k] = mixedTemp;
+            fields.mixedDens[k] = atAirTemp * (constants.airTemp / mixedTemp);
+        }
+    });
+    mixedConstants = constants;
+    mixedFieldsCurrent = true;
+}
+
+// Take physical constants from params, or from laneParams one lane at a time
+template<typename Scalar>
+void BasicSimState<Scalar>::UpdateConstants()
+{
+    if(laneParams.empty()){
+        for(int k = 0; k < FieldTypes<Scalar>::lanes; k++){
+            constants.SetLane(k, params);
+        }
+        return;
+    }
+
+    int lanes = min(int(laneParams.size()), FieldTypes<Scalar>::lanes);
+    for(int k = 0; k < lanes; k++){
+        constants.SetLane(k, laneParams[k]);
+    }
+}
+
+// Largest velocity component over interior cells
+template<typename Scalar>
+float BasicSimState<Scalar>::MaxSpeed()
+{
+    std::vector<float> rowMax(Ny + 2, 0.0f);
+    threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            float speed = 0;
+            for(int i = 1; i <= Nx; i++){
+                speed = max(speed, max(MaxAbs(fields.xVel[ind(i,j)]), MaxAbs(fields.yVel[ind(i,j)])));
             }
+            rowMax[j] = speed;
+        }
+    });
 
-            // Apply force to stream vector
-            v[ind(i,j)] += g * bForce;
+    float speed = 0;
+    for(int j = 1; j <= Ny; j++){
+        speed = max(speed, rowMax[j]);
+    }
+    return speed;
+}
+
+// Bound cells whose fields or sources depart from rest by more than the threshold,
+// grown by the cells flow crosses in this step plus a margin for interpolation, so
+// cells outside are only diffused; the whole grid unless tracking is on
+template<typename Scalar>
+void BasicSimState<Scalar>::UpdateActiveRegion(float dt)
+{
+    active = {1, Nx + 1, 1, Ny + 1};
+    activePartial = false;
+    if(!params.activeRegion){
+        return;
+    }
+
+    // Find first and last active cell of each row, and fastest flow
+    float eps = params.activeThreshold;
+    bool temperature = params.temperatureOn;
+    std::vector<CellRegion> rows(Ny + 2, CellRegion{Nx + 1, 0, 0, 0});
+    std::vector<float> rowMax(Ny + 2, 0.0f);
+    threadPool -> ParallelFor(1, Ny + 1, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            float speed = 0;
+            for(int i = 1; i <= Nx; i++){
+                int k = ind(i,j);
+                float cellSpeed = max(MaxAbs(fields.xVel[k]), MaxAbs(fields.yVel[k]));
+                speed = max(speed, cellSpeed);
+
+                // Moving, holding smoke or heat, or fed by a source
+                bool busy = cellSpeed > eps || MaxAbs(Real(fields.dens[k])) > eps ||
+                            MaxAbs(fields.xVel_source[k]) > 0 || MaxAbs(fields.yVel_source[k]) > 0 ||
+                            MaxAbs(Real(fields.dens_source[k])) > 0;
+                if(temperature){
+                    busy = busy || MaxAbs(Real(fields.temp[k]) - constants.airTemp) > eps ||
+                           Any(Real(fields.temp_source[k]) > Real(fields.temp[k]) + eps);
+                }
+                if(busy){
+                    rows[j].iStart = min(rows[j].iStart, i);
+                    rows[j].iEnd = i + 1;
+                }
+            }
+            rowMax[j] = speed;
+        }
+    });
+
+    // Box around active rows
+    CellRegion box = {Nx + 1, 0, Ny + 1, 0};
+    float speed = 0;
+    for(int j = 1; j <= Ny; j++){
+        speed = max(speed, rowMax[j]);
+        if(rows[j].iEnd > 0){
+            box.iStart = min(box.iStart, rows[j].iStart);
+            box.iEnd = max(box.iEnd, rows[j].iEnd);
+            box.jStart = min(box.jStart, j);
+            box.jEnd = j + 1;
         }
     }
+
+    // Nothing to update in a grid at rest
+    if(box.iEnd == 0){
+        active = {1, 1, 1, 1};
+        activePartial = true;
+        return;
+    }
+
+    // Grow by distance flow carries cells this step, and by two cells more
+    float cellSize = params.lengthScale / Nx;
+    int margin = 2 + (int)ceil(min(speed * dt / cellSize, float(Nx + Ny)));
+    active.iStart = max(1, box.iStart - margin);
+    active.iEnd = min(Nx + 1, box.iEnd + margin);
+    active.jStart = max(1, box.jStart - margin);
+    active.jEnd = min(Ny + 1, box.jEnd + margin);
+    activePartial = active.iStart > 1 || active.iEnd < Nx + 1 || active.jStart > 1 || active.jEnd < Ny + 1;
+}
+
+// Apply update to every cell of the active region, with the ghost cells beyond it where
+// it reaches the walls, or to the whole array when nothing is left out
+template<typename Scalar>
+template<typename CellUpdate>
+void BasicSimState<Scalar>::ForActiveCells(const CellUpdate & update)
+{
+    if(!activePartial){
+        for(int i = 0; i < size; i++){
+            update(i);
+        }
+        return;
+    }
+
+    int iStart = active.iStart == 1 ? 0 : active.iStart;
+    int iEnd = active.iEnd == Nx + 1 ? Nx + 2 : active.iEnd;
+    int jStart = active.jStart == 1 ? 0 : active.jStart;
+    int jEnd = active.jEnd == Ny + 1 ? Ny + 2 : active.jEnd;
+    for(int j = jStart; j < jEnd; j++){
+        for(int i = ind(iStart,j); i < ind(iEnd,j); i++){
+            update(i);
+        }
+    }
+}
+
+// Copy cells of x0 outside the active region into x, for steps writing x only within it
+template<typename Scalar>
+template<typename T>
+void BasicSimState<Scalar>::CopyOutsideRegion(T * x, T * x0)
+{
+    threadPool -> ParallelFor(0, Ny + 2, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+
+            // Whole rows above and below region, and either side of it in between
+            bool inside = j >= active.jStart && j < active.jEnd && active.iStart < active.iEnd;
+            int iStart = inside ? active.iStart : Nx + 2;
+            int iEnd = inside ? active.iEnd : Nx + 2;
+            for(int i = 0; i < iStart; i++){
+                x[ind(i,j)] = x0[ind(i,j)];
+            }
+            for(int i = iEnd; i < Nx + 2; i++){
+                x[ind(i,j)] = x0[ind(i,j)];
+            }
+        }
+    });
+}
+
+// Gauss-Seidel sweep over square tiles of region in turn, rows in order within each tile,
+// so the rows of a tile stay in cache while it is relaxed. Every cell still sees
+// its left and lower neighbors updated and the others not, so the result matches
+// a plain sweep in any tile size (0 sweeps whole rows). Ghost cells of each band of
+// rows are refreshed once all its tiles are done, while the band is still in cache
+template<typename Scalar>
+template<int b, typename T, typename CellUpdate>
+void BasicSimState<Scalar>::SweepTiles(T * x, const CellRegion & region, const CellUpdate & update)
+{
+    int tile = params.tileSize > 0 ? params.tileSize : max(Nx, Ny);
+
+    for(int jt = region.jStart; jt < region.jEnd; jt += tile){
+        int jEnd = min(jt + tile, region.jEnd);
+        for(int it = region.iStart; it < region.iEnd; it += tile){
+            int iEnd = min(it + tile, region.iEnd);
+            for(int j = jt; j < jEnd; j++){
+                for(int i = it; i < iEnd; i++){
+                    update(i, j);
+                }
+            }
+        }
+        for(int j = jt; j < jEnd && !heldSides; j++){
+            SetRowBoundary<b>(x, Nx, Ny, region, j);
+        }
+    }
+}
+
+// Gauss-Seidel sweeps applied together as a wavefront over rows. Sweep s relaxes
+// row j once sweep s has finished row j - 1 and sweep s - 1 has finished row j + 1,
+// so a band of about two rows per sweep stays in cache while the band moves up the
+// region. Edge ghost cells are refreshed per row as SetBoundary would between sweeps,
+// so the result matches the same number of separate sweeps exactly
+template<typename Scalar>
+template<int b, typename T, typename CellUpdate>
+void BasicSimState<Scalar>::SweepWavefront(T * x, const CellRegion & region, int sweeps, const CellUpdate & update)
+{
+    // Sweep s reaches row j of region at time j - jStart + 1 + 2s
+    int rows = region.jEnd - region.jStart;
+    for(int t = 1; t <= rows + 2 * (sweeps - 1); t++){
+        int sFirst = max(0, (t - rows + 1) / 2);
+        int sLast = min(sweeps - 1, (t - 1) / 2);
+
+        // Rows at the same time are independent, so interleave them a few cells
+        // at a time to overlap the dependency chains along each row
+        for(int it = region.iStart; it < region.iEnd; it += wavefrontCells){
+            int iEnd = min(it + wavefrontCells, region.iEnd);
+            for(int s = sFirst; s <= sLast; s++){
+                int j = region.jStart - 1 + t - 2 * s;
+                for(int i = it; i < iEnd; i++){
+                    update(i, j);
+                }
+            }
+        }
+
+        for(int s = sFirst; s <= sLast && !heldSides; s++){
+            SetRowBoundary<b>(x, Nx, Ny, region, region.jStart - 1 + t - 2 * s);
+        }
+    }
+}
+
+// Number of sweeps to apply in one pass from sweep k, ending at the next residual check
+template<typename Scalar>
+int BasicSimState<Scalar>::SweepsPerPass(int k, SimParams::SolverType solver)
+{
+    // Only lexicographic Gauss-Seidel is blocked in time
+    if(solver != SimParams::gaussSeidel || params.wavefrontSweeps < 2){
+        return 1;
+    }
+
+    int sweeps = min(params.wavefrontSweeps, params.solverSteps - k);
+    if(params.residualCheckInterval > 0){
+        sweeps = min(sweeps, params.residualCheckInterval - k % params.residualCheckInterval);
+    }
+    return sweeps;
+}
+
+// Zero solver statistics
+template<typename Scalar>
+void BasicSimState<Scalar>::ClearSolveStats()
+{
+    for(int s = 0; s < numSolves; s++){
+        solveStats[s] = { 0, -1 };
+    }
+}
+
+// Add iterations and residual of one solve to this step's statistics
+template<typename Scalar>
+void BasicSimState<Scalar>::RecordSolve(SolveType solve, int iterations, float residual)
+{
+    solveStats[solve].iterations += iterations;
+    solveStats[solve].residual = max(solveStats[solve].residual, residual);
+}
+
+// Restart worker threads if requested thread count has changed
+template<typename Scalar>
+void BasicSimState<Scalar>::UpdateThreadPool()
+{
+    if(params.numThreads < 1){
+        params.numThreads = 1;
+    }
+
+    if(threadPool -> NumThreads() != params.numThreads){
+        delete multigrid;
+        delete conjugateGradient;
+        delete threadPool;
+        threadPool = new ThreadPool(params.numThreads);
+        multigrid = nullptr;
+        conjugateGradient = nullptr;
+    }
+}
+
+// Rebuild conjugate gradient work arrays if grid has changed
+template<typename Scalar>
+void BasicSimState<Scalar>::UpdateConjugateGradient()
+{
+    if(conjugateGradient == nullptr || conjugateGradient -> GetNx() != Nx || conjugateGradient -> GetNy() != Ny){
+        delete conjugateGradient;
+        conjugateGradient = new ConjugateGradient(Nx, Ny, threadPool);
+    }
+}
+
+// Perform thermal and gravitational convection
+template<typename Scalar>
+template<bool temperature>
+void BasicSimState<Scalar>::Convect(Real * v, float dt)
+{
+    // Adjust for time scale
+    Real g = dt * constants.grav;
+
+    // Loop through grid elements, row by row
+    threadPool -> ParallelFor(active.jStart, active.jEnd, [&](int jStart, int jEnd){
+        for(int j = jStart; j < jEnd; j++){
+            for(int i = active.iStart; i < active.iEnd; i++){
+
+                // Take thermal buoyancy values derived for the step
+                Real density = temperature ? fields.mixedDens[ind(i,j)] : fields.mixedDensAtAirTemp[ind(i,j)];
+
+                // Calculate buoyant force
+                Real bForce = Where(density == 0.0, Real(1.0), (density - constants.airDens) / density);
+
+                // Apply force to stream vector
+                v[ind(i,j)] += g * bForce;
+            }
+        }
+    });
 }
 
 // Collected methods for density calculation
-void SimState::DensityStep(float dt)
+template<typename Scalar>
+template<bool closed>
+void BasicSimState<Scalar>::DensityStep(float dt)
 {
     // Add density source
     AddSource(fields.dens, fields.dens_prev, dt);
 
     // Diffuse by Fick's law
     swap(fields.dens_prev, fields.dens); 
-    Diffuse(params.closedBoundaries ? 0 : -1, fields.dens, fields.dens_prev, SimState::AdjustedMassDiffusivity, dt);
+    Diffuse<closed ? 0 : -1>(fields.dens, fields.dens_prev, fields.diff_coeff, dt, densSolve);
     swap(fields.dens_prev, fields.dens); 
 
     // Dissipate smoke
-    if(params.densDecay > 0.0){
-        if(params.tempFactor > 0.0){
-            DissipateWithFallOff(fields.dens, 0.0, params.densDecay, params.tempFactor, dt);
+    if(Any(constants.densDecay > 0.0)){
+        if(Any(constants.tempFactor > 0.0)){
+            DissipateWithFallOff(fields.dens, 0.0, constants.densDecay, constants.tempFactor, dt);
         }else{
-            Dissipate(fields.dens, 0.0, params.densDecay, dt);
+            Dissipate(fields.dens, 0.0, constants.densDecay, dt);
         }
     }
-
-    // Advect along streamlines
-    Advect(params.closedBoundaries ? 0 : -1, fields.dens, fields.dens_prev, fields.xVel, fields.yVel, dt);
 }
 
 // Collected methods for velocity calculation
-void SimState::VelocityStep(float dt)
+template<typename Scalar>
+template<bool closed, bool gravity, bool temperature>
+void BasicSimState<Scalar>::VelocityStep(float dt)
 {
     // Generate sources
     AddSource(fields.xVel, fields.xVel_prev, dt);
     AddSource(fields.yVel, fields.yVel_prev, dt);
 
     // Perform gravitational acceleration
-    if(params.gravityOn && params.grav != 0.0){
-        Convect(fields.yVel, dt);
+    if(gravity && Any(constants.grav != 0.0)){
+        Convect<temperature>(fields.yVel, dt);
     }
 
     // Perform velocity diffusion
     swap(fields.xVel_prev, fields.xVel);
-    Diffuse(params.closedBoundaries ? 1 : 0, fields.xVel, fields.xVel_prev, SimState::AdjustedViscosity, dt);
+    Diffuse<closed ? 1 : 0>(fields.xVel, fields.xVel_prev, fields.visc_coeff, dt, xVelSolve);
     swap(fields.yVel_prev, fields.yVel);
-    Diffuse(params.closedBoundaries ? 2 : 0, fields.yVel, fields.yVel_prev, SimState::AdjustedViscosity,dt);
+    Diffuse<closed ? 2 : 0>(fields.yVel, fields.yVel_prev, fields.visc_coeff, dt, yVelSolve);
 
     // Perform Hodge projection to remove divergence
-    HodgeProjection(fields.xVel, fields.yVel, fields.xVel_prev, fields.yVel_prev);
+    HodgeProjection(fields.xVel, fields.yVel, fields.pres, fields.yVel_prev);
 
     // Perform velocity advection
     swap(fields.xVel_prev, fields.xVel);
     swap(fields.yVel_prev, fields.yVel);
-    Advect(params.closedBoundaries ? 1 : 0, fields.xVel, fields.xVel_prev, fields.xVel_prev, fields.yVel_prev, dt);
-    Advect(params.closedBoundaries ? 2 : 0, fields.yVel, fields.yVel_prev, fields.xVel_prev, fields.yVel_prev, dt);
+    Real * velocities[] = { fields.xVel, fields.yVel };
+    Real * velocities_prev[] = { fields.xVel_prev, fields.yVel_prev };
+    const int velocityBoundaries[] = { closed ? 1 : 0, closed ? 2 : 0 };
+    AdvectFieldsByScheme(params.velocityAdvection, velocities, velocities_prev, 2, velocityBoundaries,
+                         fields.xVel_prev, fields.yVel_prev, dt);
+    SetBoundary(closed ? 1 : 0, fields.xVel);
+    SetBoundary(closed ? 2 : 0, fields.yVel);
 
     // Perform Hodge projection again
-    HodgeProjection(fields.xVel, fields.yVel, fields.xVel_prev, fields.yVel_prev);
+    HodgeProjection(fields.xVel, fields.yVel, fields.pres_advect, fields.yVel_prev);
 }
 
 // Collected methods for temperature calculation
-void SimState::TemperatureStep(float dt)
+template<typename Scalar>
+template<bool advanced>
+void BasicSimState<Scalar>::TemperatureStep(float dt)
 {
     // Generate sources
     AddHeatSource(fields.temp, fields.temp_prev);
 
+    // Evaluate thermal diffusivity at heated temperature
+    UpdateThermalCoefficients<advanced>();
+
     // Perform thermal diffusion
     swap(fields.temp_prev, fields.temp);
-    Diffuse(0, fields.temp, fields.temp_prev, SimState::AdjustedThermalDiffusivity, dt);
+    Diffuse<0>(fields.temp, fields.temp_prev, fields.diffTemp_coeff, dt, tempSolve);
     swap(fields.temp_prev, fields.temp);
 
     // Perform cooling due to surrounding air
-    if(params.tempDecay > 0.0){
-        Dissipate(fields.temp, params.airTemp, params.tempDecay, dt);
+    if(Any(constants.tempDecay > 0.0)){
+        Dissipate(fields.temp, constants.airTemp, constants.tempDecay, dt);
+    }
+}
+
+// Advect all scalars along streamlines in one pass
+template<typename Scalar>
+template<bool closed, bool temperature>
+void BasicSimState<Scalar>::ScalarAdvectionStep(float dt)
+{
+    // Scalars carried by the final velocity field
+    Scalar * scalars[] = { fields.dens, fields.temp };
+    Scalar * scalars_prev[] = { fields.dens_prev, fields.temp_prev };
+    const int boundaries[] = { closed ? 0 : -1, 0 };
+
+    // Advect together when sharing a scheme, sharing departure points
+    if(!temperature || params.densityAdvection == params.temperatureAdvection){
+        AdvectFieldsByScheme(params.densityAdvection, scalars, scalars_prev, temperature ? 2 : 1, boundaries,
+                             fields.xVel, fields.yVel, dt);
+    }else{
+        AdvectFieldsByScheme(params.densityAdvection, scalars, scalars_prev, 1, boundaries,
+                             fields.xVel, fields.yVel, dt);
+        AdvectFieldsByScheme(params.temperatureAdvection, scalars + 1, scalars_prev + 1, 1, boundaries + 1,
+                             fields.xVel, fields.yVel, dt);
+    }
+    SetBoundary(closed ? 0 : -1, fields.dens);
+    if(temperature){
+        SetBoundary(0, fields.temp);
+    }
+}
+
+// Full simulation step for one combination of option flags
+template<typename Scalar>
+template<bool closed, bool gravity, bool temperature, bool advanced>
+void BasicSimState<Scalar>::StepVariant(float dt)
+{
+    // Derive mixed fluid fields once for buoyancy and viscosity
+    if(advanced || (gravity && Any(constants.grav != 0.0))){
+        UpdateMixedFields();
     }
 
-    // Advect along streamlines
-    Advect(0, fields.temp, fields.temp_prev, fields.xVel, fields.yVel, dt);
+    // Evaluate diffusion coefficients of current fields
+    UpdateCoefficients<advanced>();
+
+    // Set sources as input
+    SetSource(fields.dens_prev, fields.dens_source);
+    SetSource(fields.xVel_prev, fields.xVel_source);
+    SetSource(fields.yVel_prev, fields.yVel_source);
+    SetSource(fields.temp_prev, fields.temp_source);
+
+    // Start futher simulation steps
+    VelocityStep<closed, gravity, temperature>(dt);
+    DensityStep<closed>(dt);
+    if(temperature)
+        TemperatureStep<advanced>(dt);
+    ScalarAdvectionStep<closed, temperature>(dt);
+
+    // Density and temperature have moved on from the mixed fluid fields
+    mixedFieldsCurrent = false;
+}
+
+// Mass diffusivity, adjusted for temperature if advanced
+template<typename Scalar>
+template<bool advanced>
+typename BasicSimState<Scalar>::Real BasicSimState<Scalar>::AdjustedMassDiffusivity(int ind, const Constants & constants, const Fields & fields)
+{
+    return advanced
+            ? constants.diff * sqrt(fields.temp[ind] / constants.airTemp) * (fields.temp[ind] / constants.airTemp)
+            : constants.diff;
+}
+
+// Viscosity, adjusted for temperature if advanced, from mixed fluid fields of the step
+template<typename Scalar>
+template<bool advanced>
+typename BasicSimState<Scalar>::Real BasicSimState<Scalar>::AdjustedViscosity(int ind, const Constants & constants, const Fields & fields)
+{
+    return advanced
+            ? constants.visc * sqrt(fields.mixedTemp[ind] / constants.airTemp) / fields.mixedDensAtAirTemp[ind]
+            : constants.visc;
+}
+
+// Thermal diffusivity, adjusted for temperature if advanced
+template<typename Scalar>
+template<bool advanced>
+typename BasicSimState<Scalar>::Real BasicSimState<Scalar>::AdjustedThermalDiffusivity(int ind, const Constants & constants, const Fields & fields)
+{
+    return advanced
+            ? constants.diffTemp * sqrt(fields.temp[ind] / constants.airTemp)
+            : constants.diffTemp;
 }
 
 
@@ -519,6 +1784,31 @@ SimParams::SimParams()
     temperatureOn = false;
     advancedCoefficients = false;
     solverSteps = 20;
+    diffusionSolver = gaussSeidel;
+    pressureSolver = gaussSeidel;
+    numThreads = 1;
+    multigridCycles = 2;
+    solverTolerance = 0.0001;
+    solverMaxIterations = 100;
+    residualCheckInterval = 0;
+    warmStartPressure = true;
+    tileSize = 32;
+    wavefrontSweeps = 4;
+    hugePages = false;
+    adaptiveTimeStep = false;
+    targetCFL = 1.0;
+    maxSubsteps = 8;
+    velocityAdvection = semiLagrangian;
+    densityAdvection = semiLagrangian;
+    temperatureAdvection = semiLagrangian;
+    activeRegion = false;
+    activeThreshold = 0.0001;
+    sparseGrid = false;
+    amrLevels = 0;
+    amrPatchSize = 64;
+    amrDensity = 0.0;
+    amrGradient = 0.02;
+    amrVorticity = 0.05;
 }
 
 // Constructor for simple advection/diffusion simulation
@@ -546,6 +1836,31 @@ SimParams::SimParams(float lengthScale, float timeScale, float viscosity, float
     temperatureOn = false;
     advancedCoefficients = false;
     solverSteps = 20;
+    diffusionSolver = gaussSeidel;
+    pressureSolver = gaussSeidel;
+    numThreads = 1;
+    multigridCycles = 2;
+    solverTolerance = 0.0001;
+    solverMaxIterations = 100;
+    residualCheckInterval = 0;
+    warmStartPressure = true;
+    tileSize = 32;
+    wavefrontSweeps = 4;
+    hugePages = false;
+    adaptiveTimeStep = false;
+    targetCFL = 1.0;
+    maxSubsteps = 8;
+    velocityAdvection = semiLagrangian;
+    densityAdvection = semiLagrangian;
+    temperatureAdvection = semiLagrangian;
+    activeRegion = false;
+    activeThreshold = 0.0001;
+    sparseGrid = false;
+    amrLevels = 0;
+    amrPatchSize = 64;
+    amrDensity = 0.0;
+    amrGradient = 0.02;
+    amrVorticity = 0.05;
 
 }
 
@@ -575,6 +1890,31 @@ SimParams::SimParams(float lengthScale, float timeScale, float viscosity, float
     temperatureOn = false;
     advancedCoefficients = false;
     solverSteps = 20;
+    diffusionSolver = gaussSeidel;
+    pressureSolver = gaussSeidel;
+    numThreads = 1;
+    multigridCycles = 2;
+    solverTolerance = 0.0001;
+    solverMaxIterations = 100;
+    residualCheckInterval = 0;
+    warmStartPressure = true;
+    tileSize = 32;
+    wavefrontSweeps = 4;
+    hugePages = false;
+    adaptiveTimeStep = false;
+    targetCFL = 1.0;
+    maxSubsteps = 8;
+    velocityAdvection = semiLagrangian;
+    densityAdvection = semiLagrangian;
+    temperatureAdvection = semiLagrangian;
+    activeRegion = false;
+    activeThreshold = 0.0001;
+    sparseGrid = false;
+    amrLevels = 0;
+    amrPatchSize = 64;
+    amrDensity = 0.0;
+    amrGradient = 0.02;
+    amrVorticity = 0.05;
 
 }
 
@@ -605,6 +1945,31 @@ SimParams::SimParams(float lengthScale, float timeScale, float viscosity, float
     temperatureOn = true;
     advancedCoefficients = true;
     solverSteps = 20;
+    diffusionSolver = gaussSeidel;
+    pressureSolver = gaussSeidel;
+    numThreads = 1;
+    multigridCycles = 2;
+    solverTolerance = 0.0001;
+    solverMaxIterations = 100;
+    residualCheckInterval = 0;
+    warmStartPressure = true;
+    tileSize = 32;
+    wavefrontSweeps = 4;
+    hugePages = false;
+    adaptiveTimeStep = false;
+    targetCFL = 1.0;
+    maxSubsteps = 8;
+    velocityAdvection = semiLagrangian;
+    densityAdvection = semiLagrangian;
+    temperatureAdvection = semiLagrangian;
+    activeRegion = false;
+    activeThreshold = 0.0001;
+    sparseGrid = false;
+    amrLevels = 0;
+    amrPatchSize = 64;
+    amrDensity = 0.0;
+    amrGradient = 0.02;
+    amrVorticity = 0.05;
 
 }
 
@@ -634,6 +1999,31 @@ SimParams::SimParams(float lengthScale, float timeScale, float viscosity, float
     temperatureOn = true;
     advancedCoefficients = true;
     solverSteps = 20;
+    diffusionSolver = gaussSeidel;
+    pressureSolver = gaussSeidel;
+    numThreads = 1;
+    multigridCycles = 2;
+    solverTolerance = 0.0001;
+    solverMaxIterations = 100;
+    residualCheckInterval = 0;
+    warmStartPressure = true;
+    tileSize = 32;
+    wavefrontSweeps = 4;
+    hugePages = false;
+    adaptiveTimeStep = false;
+    targetCFL = 1.0;
+    maxSubsteps = 8;
+    velocityAdvection = semiLagrangian;
+    densityAdvection = semiLagrangian;
+    temperatureAdvection = semiLagrangian;
+    activeRegion = false;
+    activeThreshold = 0.0001;
+    sparseGrid = false;
+    amrLevels = 0;
+    amrPatchSize = 64;
+    amrDensity = 0.0;
+    amrGradient = 0.02;
+    amrVorticity = 0.05;
 }
 
 // Return pointer to float by index
@@ -786,45 +2176,200 @@ float SimParams::FloatMax(int paramNum, ParamType type)
     return maxs[type][paramNum];
 }
 
+// Copy constants of one lane from parameters
+template<typename Real>
+void PhysicalConstants<Real>::SetLane(int lane, const SimParams & params)
+{
+    ::SetLane(visc, lane, params.visc);
+    ::SetLane(diff, lane, params.diff);
+    ::SetLane(grav, lane, params.grav);
+    ::SetLane(airDens, lane, params.airDens);
+    ::SetLane(massRatio, lane, params.massRatio);
+    ::SetLane(airTemp, lane, params.airTemp);
+    ::SetLane(diffTemp, lane, params.diffTemp);
+    ::SetLane(densDecay, lane, params.densDecay);
+    ::SetLane(tempFactor, lane, params.tempFactor);
+    ::SetLane(tempDecay, lane, params.tempDecay);
+}
+
+// Field planes of each type in arena order, Real planes first
+template<typename Scalar>
+static typename BasicSimFields<Scalar>::Real * BasicSimFields<Scalar>::* const realPlanes[] = {
+    &BasicSimFields<Scalar>::xVel,        &BasicSimFields<Scalar>::yVel,
+    &BasicSimFields<Scalar>::xVel_prev,   &BasicSimFields<Scalar>::yVel_prev,
+    &BasicSimFields<Scalar>::xVel_source, &BasicSimFields<Scalar>::yVel_source,
+    &BasicSimFields<Scalar>::pres,        &BasicSimFields<Scalar>::pres_advect,
+    &BasicSimFields<Scalar>::visc_coeff,  &BasicSimFields<Scalar>::diff_coeff,  &BasicSimFields<Scalar>::diffTemp_coeff,
+    &BasicSimFields<Scalar>::mixedDensAtAirTemp, &BasicSimFields<Scalar>::mixedDens, &BasicSimFields<Scalar>::mixedTemp
+};
+template<typename Scalar>
+static Scalar * BasicSimFields<Scalar>::* const scalarPlanes[] = {
+    &BasicSimFields<Scalar>::dens,        &BasicSimFields<Scalar>::temp,
+    &BasicSimFields<Scalar>::dens_prev,   &BasicSimFields<Scalar>::temp_prev,
+    &BasicSimFields<Scalar>::dens_source, &BasicSimFields<Scalar>::temp_source
+};
+static const int numRealPlanes = 14;
+static const int numScalarPlanes = 6;
+
+// Arena alignment, to cache lines or to transparent huge pages
+static const size_t planeAlignment = 64;
+static const size_t hugePageSize = 2 << 20;
+
+// Bytes of one plane of given element size, rounded up to whole cache lines
+static size_t PlaneBytes(int size, size_t elementSize)
+{
+    return (size * elementSize + planeAlignment - 1) / planeAlignment * planeAlignment;
+}
+
 // Field object constructor, bare
-SimFields::SimFields()
+template<typename Scalar>
+BasicSimFields<Scalar>::BasicSimFields()
 {
-    // Default to 10 x 10 grid
-    SimFields(100);
+    // Empty until a grid is allocated
+    arena = nullptr;
+    for(int f = 0; f < numRealPlanes; f++){
+        this ->* realPlanes<Scalar>[f] = nullptr;
+    }
+    for(int f = 0; f < numScalarPlanes; f++){
+        this ->* scalarPlanes<Scalar>[f] = nullptr;
+    }
 }
 
 // Field object constructor
-SimFields::SimFields(int size)
-{
-    // Initialize all arrays
-    xVel          = new float[size];
-    yVel          = new float[size];
-    dens          = new float[size];
-    temp          = new float[size];
-    xVel_prev     = new float[size];
-    yVel_prev     = new float[size];
-    dens_prev     = new float[size];
-    temp_prev     = new float[size];
-    xVel_source   = new float[size];
-    yVel_source   = new float[size];
-    dens_source   = new float[size];
-    temp_source   = new float[size];
+template<typename Scalar>
+BasicSimFields<Scalar>::BasicSimFields(int size, bool hugePages)
+{
+    // Round planes up to whole cache lines so each one stays aligned
+    size_t realStride = PlaneBytes(size, sizeof(Real));
+    size_t scalarStride = PlaneBytes(size, sizeof(Scalar));
+    size_t bytes = realStride * numRealPlanes + scalarStride * numScalarPlanes;
+
+    // Allocate all planes at once, leaving pages untouched for the first writer
+    size_t alignment = hugePages ? hugePageSize : planeAlignment;
+    if(hugePages){
+        bytes = (bytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+    }
+    void * memory = nullptr;
+    if(posix_memalign(&memory, alignment, bytes) != 0){
+        throw bad_alloc();
+    }
+    arena = static_cast<char *>(memory);
+
+#ifdef MADV_HUGEPAGE
+    // Ask for transparent huge pages to cut TLB misses on large grids
+    if(hugePages){
+        madvise(memory, bytes, MADV_HUGEPAGE);
+    }
+#endif
+
+    // Point each field at its plane
+    char * plane = arena;
+    for(int f = 0; f < numRealPlanes; f++, plane += realStride){
+        this ->* realPlanes<Scalar>[f] = reinterpret_cast<Real *>(plane);
+    }
+    for(int f = 0; f < numScalarPlanes; f++, plane += scalarStride){
+        this ->* scalarPlanes<Scalar>[f] = reinterpret_cast<Scalar *>(plane);
+    }
+}
+
+// Move constructor, taking over arena
+template<typename Scalar>
+BasicSimFields<Scalar>::BasicSimFields(BasicSimFields && other)
+{
+    arena = nullptr;
+    *this = move(other);
+}
+
+// Move assignment, freeing own arena first
+template<typename Scalar>
+BasicSimFields<Scalar> & BasicSimFields<Scalar>::operator=(BasicSimFields && other)
+{
+    if(this != &other){
+        ClearFields();
+        arena = other.arena;
+        other.arena = nullptr;
+        for(int f = 0; f < numRealPlanes; f++){
+            this ->* realPlanes<Scalar>[f] = other.*realPlanes<Scalar>[f];
+            other.*realPlanes<Scalar>[f] = nullptr;
+        }
+        for(int f = 0; f < numScalarPlanes; f++){
+            this ->* scalarPlanes<Scalar>[f] = other.*scalarPlanes<Scalar>[f];
+            other.*scalarPlanes<Scalar>[f] = nullptr;
+        }
+    }
+    return *this;
+}
+
+// Destructor
+template<typename Scalar>
+BasicSimFields<Scalar>::~BasicSimFields()
+{
+    ClearFields();
+}
+
+// Zero cells [start, end) of every plane, faulting in their pages
+template<typename Scalar>
+void BasicSimFields<Scalar>::ZeroFields(int start, int end)
+{
+    for(int f = 0; f < numRealPlanes; f++){
+        Real * plane = this ->* realPlanes<Scalar>[f];
+        for(int i = start; i < end; i++){
+            plane[i] = 0.0f;
+        }
+    }
+    for(int f = 0; f < numScalarPlanes; f++){
+        Scalar * plane = this ->* scalarPlanes<Scalar>[f];
+        for(int i = start; i < end; i++){
+            plane[i] = 0.0f;
+        }
+    }
 }
 
 // Delete field arrays
-void SimFields::ClearFields()
-{
-    // Delete all arrays
-    delete[] xVel;
-    delete[] yVel;
-    delete[] dens;
-    delete[] temp;
-    delete[] xVel_prev;
-    delete[] yVel_prev;
-    delete[] dens_prev;
-    delete[] temp_prev;
-    delete[] xVel_source;
-    delete[] yVel_source;
-    delete[] dens_source;
-    delete[] temp_source;
+template<typename Scalar>
+void BasicSimFields<Scalar>::ClearFields()
+{
+    // Free arena and forget planes
+    free(arena);
+    arena = nullptr;
+    for(int f = 0; f < numRealPlanes; f++){
+        this ->* realPlanes<Scalar>[f] = nullptr;
+    }
+    for(int f = 0; f < numScalarPlanes; f++){
+        this ->* scalarPlanes<Scalar>[f] = nullptr;
+    }
 }
+
+
+
+/// INSTANTIATIONS ///
+
+// Field storage precisions
+template struct BasicSimFields<float>;
+template struct BasicSimFields<double>;
+template struct BasicSimFields<Half>;
+template struct BasicSimFields<BFloat16>;
+
+template class BasicSimState<float>;
+template class BasicSimState<double>;
+template class BasicSimState<Half>;
+template class BasicSimState<BFloat16>;
+
+// Ensembles of simulations stepped together, at common vector widths
+template struct PhysicalConstants<float>;
+template struct PhysicalConstants<Lanes<float, 4>>;
+template struct PhysicalConstants<Lanes<float, 8>>;
+template struct PhysicalConstants<Lanes<float, 16>>;
+
+template struct BasicSimFields<Lanes<float, 4>>;
+template struct BasicSimFields<Lanes<float, 8>>;
+template struct BasicSimFields<Lanes<float, 16>>;
+
+template class BasicSimState<Lanes<float, 4>>;
+template class BasicSimState<Lanes<float, 8>>;
+template class BasicSimState<Lanes<float, 16>>;
+
+// Boundary conditions used by the pressure solvers
+template void BasicSimState<float>::SetBoundary<float>(int b, float * x, int Nx, int Ny);
+template void BasicSimState<float>::SetRowBoundary<0, float>(float * x, int Nx, int Ny, const CellRegion & region, int j);
+template void BasicSimState<float>::SetCorners<float>(float * x, int Nx, int Ny);
@@ -0,0 +1,529 @@
+/* Function definition file for simulations on sparse brick grids */
+
+// Include header definitions
+#include "headers/SparseSimState.h"
+
+// Includes and usings
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+// Macros
+#define B BrickGrid::brickSize
+#define H BrickGrid::haloSize
+#define cell(li,lj) ((li) + B*(lj))
+#define halo(li,lj) ((li) + 1 + H*((lj) + 1))
+
+
+
+//// PUBLIC METHODS ////
+
+// Constructor taking param struct, for square grid
+SparseSimState::SparseSimState(int N, SimParams params) : SparseSimState(N, N, params)
+{
+}
+
+// Constructor taking param struct, for grid of Nx by Ny cells
+SparseSimState::SparseSimState(int Nx, int Ny, SimParams params)
+{
+    this -> params = params;
+
+    // Bricks are allocated as sources are set and fields spread
+    std::vector<float> background(numPlanes, 0.0f);
+    background[tempPlane] = params.airTemp;
+    background[tempPrevPlane] = params.airTemp;
+    background[tempSourcePlane] = params.airTemp;
+    grid = new BrickGrid(Nx, Ny, background);
+
+    threadPool = new ThreadPool(params.numThreads);
+    constants.SetLane(0, params);
+    UpdateWalls();
+    ResetState();
+}
+
+// Destructor
+SparseSimState::~SparseSimState()
+{
+    delete grid;
+    delete threadPool;
+}
+
+// Run simulation step
+void SparseSimState::SimulationStep(float timeStep)
+{
+    // Adjust for time scale
+    float dt = timeStep * params.timeScale;
+
+    // Take physical constants for this step, with air at rest at air temperature
+    constants.SetLane(0, params);
+    grid -> SetBackground(tempPlane, constants.airTemp);
+    grid -> SetBackground(tempPrevPlane, constants.airTemp);
+    grid -> SetBackground(tempSourcePlane, constants.airTemp);
+    UpdateWalls();
+
+    // Keep bricks this step can reach
+    UpdateBricks(dt);
+
+    VelocityStep(dt);
+    DensityStep(dt);
+    if(params.temperatureOn){
+        TemperatureStep(dt);
+    }
+    ScalarAdvectionStep(dt);
+}
+
+// Set source rates of density and velocity, and source temperature, of cell (i, j)
+void SparseSimState::SetSource(int i, int j, float density, float temperature, float xVelocity, float yVelocity)
+{
+    grid -> Set(densSourcePlane, i, j, density);
+    grid -> Set(tempSourcePlane, i, j, temperature);
+    grid -> Set(xVelSourcePlane, i, j, xVelocity);
+    grid -> Set(yVelSourcePlane, i, j, yVelocity);
+}
+
+// Replace sources with those of source, summing rates and taking the hottest
+// temperature where sources overlap, as SimSource does on a full grid
+void SparseSimState::SetSources(SimSource * source)
+{
+    ClearSources();
+    source -> ApplySources([&](int i, int j, float xVelocity, float yVelocity, float density, float temperature){
+        grid -> Set(xVelSourcePlane, i, j, grid -> Get(xVelSourcePlane, i, j) + xVelocity);
+        grid -> Set(yVelSourcePlane, i, j, grid -> Get(yVelSourcePlane, i, j) + yVelocity);
+        grid -> Set(densSourcePlane, i, j, grid -> Get(densSourcePlane, i, j) + density);
+        grid -> Set(tempSourcePlane, i, j, max(grid -> Get(tempSourcePlane, i, j), temperature));
+    });
+}
+
+// Remove all sources
+void SparseSimState::ClearSources()
+{
+    ForBricks([&](const Brick & brick){
+        for(int c = 0; c < B * B; c++){
+            grid -> Cells(densSourcePlane, brick.slot)[c] = 0.0;
+            grid -> Cells(tempSourcePlane, brick.slot)[c] = grid -> GetBackground(tempSourcePlane);
+            grid -> Cells(xVelSourcePlane, brick.slot)[c] = 0.0;
+            grid -> Cells(yVelSourcePlane, brick.slot)[c] = 0.0;
+        }
+    });
+}
+
+// Release every brick, leaving air at rest
+void SparseSimState::ResetState()
+{
+    while(!grid -> ActiveBricks().empty()){
+        grid -> Release(grid -> ActiveBricks().back());
+    }
+
+    xVel = xVelPlane;
+    yVel = yVelPlane;
+    dens = densPlane;
+    temp = tempPlane;
+    xVel_prev = xVelPrevPlane;
+    yVel_prev = yVelPrevPlane;
+    dens_prev = densPrevPlane;
+    temp_prev = tempPrevPlane;
+}
+
+// Cell accessors
+float SparseSimState::GetDensity(int i, int j) { return grid -> Get(dens, i, j); }
+float SparseSimState::GetXVelocity(int i, int j) { return grid -> Get(xVel, i, j); }
+float SparseSimState::GetYVelocity(int i, int j) { return grid -> Get(yVel, i, j); }
+float SparseSimState::GetTemperature(int i, int j) { return grid -> Get(temp, i, j); }
+
+// Grid size accessors
+int SparseSimState::GetNx() { return grid -> GetNx(); }
+int SparseSimState::GetNy() { return grid -> GetNy(); }
+
+// Density summed over allocated bricks, the only cells holding any
+float SparseSimState::GetTotalDensity()
+{
+    const std::vector<int> & bricks = grid -> ActiveBricks();
+    std::vector<double> sums(bricks.size(), 0.0);
+    ForBricks([&](const Brick & brick){
+        float * d = grid -> Cells(dens, brick.slot);
+        for(int lj = 0; lj < brick.jCount; lj++){
+            for(int li = 0; li < brick.iCount; li++){
+                sums[brick.k] += d[cell(li,lj)];
+            }
+        }
+    });
+
+    double total = 0;
+    for(double sum : sums){
+        total += sum;
+    }
+    return total;
+}
+
+// Bricks allocated
+int SparseSimState::GetActiveBricks() { return grid -> ActiveBricks().size(); }
+
+// Bytes held by bricks, brick table, and halo copies
+size_t SparseSimState::GetMemory() { return grid -> GetMemory() + halos.capacity() * sizeof(float); }
+
+
+//// PRIVATE METHODS ////
+
+// Set conditions at the walls of each plane as SimState sets its fields, closed or open
+void SparseSimState::UpdateWalls()
+{
+    bool closed = params.closedBoundaries;
+    grid -> SetWalls(densPlane,     closed ? 0 : -1);
+    grid -> SetWalls(densPrevPlane, closed ? 0 : -1);
+    grid -> SetWalls(xVelPlane,     closed ? 1 : 0);
+    grid -> SetWalls(xVelPrevPlane, closed ? 1 : 0);
+    grid -> SetWalls(yVelPlane,     closed ? 2 : 0);
+    grid -> SetWalls(yVelPrevPlane, closed ? 2 : 0);
+    grid -> SetWalls(tempPlane,     0);
+    grid -> SetWalls(tempPrevPlane, 0);
+    grid -> SetWalls(presPlane,     0);
+    grid -> SetWalls(presAdvectPlane, 0);
+}
+
+// Keep bricks departing from rest or holding sources, with the bricks around them flow
+// can reach this step, and release the rest
+void SparseSimState::UpdateBricks(float dt)
+{
+    const std::vector<int> & bricks = grid -> ActiveBricks();
+    int count = bricks.size();
+
+    // Find busy bricks, and fastest flow
+    float eps = params.activeThreshold;
+    bool temperature = params.temperatureOn;
+    std::vector<char> busy(count, 0);
+    std::vector<float> brickMax(count, 0.0f);
+    ForBricks([&](const Brick & brick){
+        float * u = grid -> Cells(xVel, brick.slot);
+        float * v = grid -> Cells(yVel, brick.slot);
+        float * d = grid -> Cells(dens, brick.slot);
+        float * t = grid -> Cells(temp, brick.slot);
+        float * su = grid -> Cells(xVelSourcePlane, brick.slot);
+        float * sv = grid -> Cells(yVelSourcePlane, brick.slot);
+        float * sd = grid -> Cells(densSourcePlane, brick.slot);
+        float * st = grid -> Cells(tempSourcePlane, brick.slot);
+
+        float speed = 0;
+        bool any = false;
+        for(int c = 0; c < B * B; c++){
+            float cellSpeed = max(fabs(u[c]), fabs(v[c]));
+            speed = max(speed, cellSpeed);
+            any = any || cellSpeed > eps || fabs(d[c]) > eps ||
+                  su[c] != 0 || sv[c] != 0 || sd[c] != 0 ||
+                  (temperature && (fabs(t[c] - constants.airTemp) > eps || st[c] > t[c] + eps));
+        }
+        busy[brick.k] = any;
+        brickMax[brick.k] = speed;
+    });
+
+    // Bricks flow can cross in one step, beyond the one next to each busy brick
+    float speed = 0;
+    for(int k = 0; k < count; k++){
+        speed = max(speed, brickMax[k]);
+    }
+    float cellSize = params.lengthScale / grid -> GetNx();
+    int bricksX = grid -> GetBricksX();
+    int bricksY = grid -> GetBricksY();
+    int margin = 1 + (int)ceil(min(speed * dt / cellSize / B, float(bricksX + bricksY)));
+
+    // Mark bricks around busy ones
+    keep.resize(bricksX * bricksY, 0);
+    std::vector<int> kept;
+    for(int k = 0; k < count; k++){
+        if(!busy[k]){
+            continue;
+        }
+        int bi = grid -> BrickX(bricks[k]);
+        int bj = grid -> BrickY(bricks[k]);
+        for(int nj = max(0, bj - margin); nj <= min(bricksY - 1, bj + margin); nj++){
+            for(int ni = max(0, bi - margin); ni <= min(bricksX - 1, bi + margin); ni++){
+                if(!keep[ni + bricksX * nj]){
+                    keep[ni + bricksX * nj] = 1;
+                    kept.push_back(ni + bricksX * nj);
+                }
+            }
+        }
+    }
+
+    // Release bricks left at rest, then allocate marked bricks not yet held
+    for(int k = count - 1; k >= 0; k--){
+        int slot = bricks[k];
+        if(!keep[grid -> BrickX(slot) + bricksX * grid -> BrickY(slot)]){
+            grid -> Release(slot);
+        }
+    }
+    for(int b : kept){
+        grid -> Activate(b % bricksX, b / bricksX);
+        keep[b] = 0;
+    }
+}
+
+// Apply update to every allocated brick in parallel
+void SparseSimState::ForBricks(const std::function<void(const Brick & brick)> & update)
+{
+    const std::vector<int> & bricks = grid -> ActiveBricks();
+    threadPool -> ParallelFor(0, bricks.size(), [&](int kStart, int kEnd){
+        for(int k = kStart; k < kEnd; k++){
+            Brick brick;
+            brick.k = k;
+            brick.slot = bricks[k];
+            brick.i0 = grid -> BrickX(brick.slot) * B;
+            brick.j0 = grid -> BrickY(brick.slot) * B;
+            brick.iCount = min(B, grid -> GetNx() - brick.i0);
+            brick.jCount = min(B, grid -> GetNy() - brick.j0);
+            update(brick);
+        }
+    });
+}
+
+// Copy every brick of plane with its halo into halos, in the order of the brick list,
+// so sweeps can write cells while reading neighbors across brick edges
+void SparseSimState::GatherHalos(int plane)
+{
+    halos.resize(grid -> ActiveBricks().size() * H * H);
+    ForBricks([&](const Brick & brick){
+        grid -> GatherHalo(plane, brick.slot, halos.data() + brick.k * H * H);
+    });
+}
+
+// Add source values into field
+void SparseSimState::AddSource(int x, int s, float dt)
+{
+    ForBricks([&](const Brick & brick){
+        float * xc = grid -> Cells(x, brick.slot);
+        float * sc = grid -> Cells(s, brick.slot);
+        for(int c = 0; c < B * B; c++){
+            xc[c] = xc[c] + dt * sc[c];
+        }
+    });
+}
+
+// Add heat source via maximum temp, as in SimState
+void SparseSimState::AddHeatSource(int t, int s)
+{
+    ForBricks([&](const Brick & brick){
+        float * tc = grid -> Cells(t, brick.slot);
+        float * sc = grid -> Cells(s, brick.slot);
+        for(int c = 0; c < B * B; c++){
+            tc[c] = max(tc[c], sc[c]);
+        }
+    });
+}
+
+// Decay field toward equilibrium, slower in hot cells when fallOff is set
+void SparseSimState::Dissipate(int x, float eqVal, float rate, float fallOff, float dt)
+{
+    if(rate <= 0){
+        return;
+    }
+
+    float d = rate * dt;
+    ForBricks([&](const Brick & brick){
+        float * xc = grid -> Cells(x, brick.slot);
+        float * tc = grid -> Cells(temp, brick.slot);
+        for(int c = 0; c < B * B; c++){
+            xc[c] = xc[c] - d * (1. - fallOff * (tc[c] - constants.airTemp)) * (xc[c] - eqVal);
+        }
+    });
+}
+
+// Perform thermal and gravitational convection
+void SparseSimState::Convect(float dt)
+{
+    float g = dt * constants.grav;
+    bool temperature = params.temperatureOn;
+    ForBricks([&](const Brick & brick){
+        float * v = grid -> Cells(yVel, brick.slot);
+        float * d = grid -> Cells(dens, brick.slot);
+        float * t = grid -> Cells(temp, brick.slot);
+        for(int c = 0; c < B * B; c++){
+            float density = temperature ? constants.MixedDensity(d[c], t[c])
+                                        : constants.MixedDensityAtAirTemp(d[c]);
+            float bForce = density == 0.0 ? 1.0 : (density - constants.airDens) / density;
+            v[c] += g * bForce;
+        }
+    });
+}
+
+// Diffuse x0 into x by red-black sweeps, with air at rest beyond the bricks and the
+// walls set for x
+void SparseSimState::Diffuse(int x, int x0, float coeff, float dt)
+{
+    // Adjust a to account for cell size and timestep
+    float cellSize = params.lengthScale / grid -> GetNx();
+    float a_t = coeff * dt / (cellSize * cellSize);
+
+    // Start from undiffused field
+    ForBricks([&](const Brick & brick){
+        std::copy(grid -> Cells(x0, brick.slot), grid -> Cells(x0, brick.slot) + B * B, grid -> Cells(x, brick.slot));
+    });
+
+    // Cells of one color only read cells of the other, so bricks are independent
+    for(int step = 0; step < params.solverSteps; step++){
+        for(int color = 0; color < 2; color++){
+            GatherHalos(x);
+            ForBricks([&](const Brick & brick){
+                float * xc = grid -> Cells(x, brick.slot);
+                float * x0c = grid -> Cells(x0, brick.slot);
+                float * h = halos.data() + brick.k * H * H;
+                for(int lj = 0; lj < brick.jCount; lj++){
+                    for(int li = (brick.i0 + brick.j0 + lj + color) % 2; li < brick.iCount; li += 2){
+                        xc[cell(li,lj)] = (x0c[cell(li,lj)] + a_t*(h[halo(li-1,lj)] + h[halo(li+1,lj)] +
+                                           h[halo(li,lj-1)] + h[halo(li,lj+1)])) / (1 + 4*a_t);
+                    }
+                }
+            });
+        }
+    }
+}
+
+// Remove divergence of velocity by red-black relaxation of pressure plane p, held at
+// zero beyond the bricks and reflected at the walls
+void SparseSimState::Project(int p)
+{
+    float cellSize = params.lengthScale / grid -> GetNx();
+
+    // Calculate divergence in each cell, and seed pressure with last solution or zero
+    ForBricks([&](const Brick & brick){
+        float u[H * H], v[H * H];
+        grid -> GatherHalo(xVel, brick.slot, u);
+        grid -> GatherHalo(yVel, brick.slot, v);
+        float * div = grid -> Cells(divPlane, brick.slot);
+        for(int lj = 0; lj < brick.jCount; lj++){
+            for(int li = 0; li < brick.iCount; li++){
+                div[cell(li,lj)] = -0.5 * cellSize * (u[halo(li+1,lj)] - u[halo(li-1,lj)] +
+                                                      v[halo(li,lj+1)] - v[halo(li,lj-1)]);
+            }
+        }
+        if(!params.warmStartPressure){
+            std::fill(grid -> Cells(p, brick.slot), grid -> Cells(p, brick.slot) + B * B, 0.0f);
+        }
+    });
+
+    // Relax pressure, each color in parallel
+    for(int step = 0; step < params.solverSteps; step++){
+        for(int color = 0; color < 2; color++){
+            GatherHalos(p);
+            ForBricks([&](const Brick & brick){
+                float * pres = grid -> Cells(p, brick.slot);
+                float * div = grid -> Cells(divPlane, brick.slot);
+                float * h = halos.data() + brick.k * H * H;
+                for(int lj = 0; lj < brick.jCount; lj++){
+                    for(int li = (brick.i0 + brick.j0 + lj + color) % 2; li < brick.iCount; li += 2){
+                        pres[cell(li,lj)] = (div[cell(li,lj)] + h[halo(li-1,lj)] + h[halo(li+1,lj)] +
+                                                             h[halo(li,lj-1)] + h[halo(li,lj+1)]) / 4;
+                    }
+                }
+            });
+        }
+    }
+
+    // Subtract pressure gradient
+    GatherHalos(p);
+    ForBricks([&](const Brick & brick){
+        float * u = grid -> Cells(xVel, brick.slot);
+        float * v = grid -> Cells(yVel, brick.slot);
+        float * h = halos.data() + brick.k * H * H;
+        for(int lj = 0; lj < brick.jCount; lj++){
+            for(int li = 0; li < brick.iCount; li++){
+                u[cell(li,lj)] -= 0.5 * (h[halo(li+1,lj)] - h[halo(li-1,lj)]) / cellSize;
+                v[cell(li,lj)] -= 0.5 * (h[halo(li,lj+1)] - h[halo(li,lj-1)]) / cellSize;
+            }
+        }
+    });
+}
+
+// Advect fields d0 into d along velocity planes (u, v) by semi-Lagrangian steps,
+// sampling across bricks through the brick table
+void SparseSimState::Advect(const int * d, const int * d0, int count, int u, int v, float dt)
+{
+    int Nx = grid -> GetNx();
+    int Ny = grid -> GetNy();
+    float cellSize = params.lengthScale / Nx;
+    float dt0 = dt / cellSize;
+
+    ForBricks([&](const Brick & brick){
+        float * uc = grid -> Cells(u, brick.slot);
+        float * vc = grid -> Cells(v, brick.slot);
+        for(int lj = 0; lj < brick.jCount; lj++){
+            for(int li = 0; li < brick.iCount; li++){
+
+                // Departure point, kept within the grid as in SimState
+                float x = brick.i0 + li + 1 - dt0 * uc[cell(li,lj)];
+                float y = brick.j0 + lj + 1 - dt0 * vc[cell(li,lj)];
+                x = min(max(x, 0.5f), Nx + 0.5f);
+                y = min(max(y, 0.5f), Ny + 0.5f);
+
+                for(int f = 0; f < count; f++){
+                    grid -> Cells(d[f], brick.slot)[cell(li,lj)] = grid -> Sample(d0[f], x, y);
+                }
+            }
+        }
+    });
+}
+
+// Collected methods for velocity calculation
+void SparseSimState::VelocityStep(float dt)
+{
+    // Generate sources
+    AddSource(xVel, xVelSourcePlane, dt);
+    AddSource(yVel, yVelSourcePlane, dt);
+
+    // Perform gravitational acceleration
+    if(params.gravityOn && constants.grav != 0.0){
+        Convect(dt);
+    }
+
+    // Perform velocity diffusion
+    swap(xVel_prev, xVel);
+    Diffuse(xVel, xVel_prev, constants.visc, dt);
+    swap(yVel_prev, yVel);
+    Diffuse(yVel, yVel_prev, constants.visc, dt);
+
+    // Perform Hodge projection to remove divergence
+    Project(presPlane);
+
+    // Perform velocity advection, then project again
+    swap(xVel_prev, xVel);
+    swap(yVel_prev, yVel);
+    int velocities[] = { xVel, yVel };
+    int velocities_prev[] = { xVel_prev, yVel_prev };
+    Advect(velocities, velocities_prev, 2, xVel_prev, yVel_prev, dt);
+    Project(presAdvectPlane);
+}
+
+// Collected methods for density calculation
+void SparseSimState::DensityStep(float dt)
+{
+    AddSource(dens, densSourcePlane, dt);
+
+    swap(dens_prev, dens);
+    Diffuse(dens, dens_prev, constants.diff, dt);
+
+    Dissipate(dens, 0.0, constants.densDecay, constants.tempFactor, dt);
+}
+
+// Collected methods for temperature calculation
+void SparseSimState::TemperatureStep(float dt)
+{
+    AddHeatSource(temp, tempSourcePlane);
+
+    swap(temp_prev, temp);
+    Diffuse(temp, temp_prev, constants.diffTemp, dt);
+
+    Dissipate(temp, constants.airTemp, constants.tempDecay, 0.0, dt);
+}
+
+// Advect all scalars along streamlines in one pass
+void SparseSimState::ScalarAdvectionStep(float dt)
+{
+    swap(dens_prev, dens);
+    swap(temp_prev, temp);
+    int scalars[] = { dens, temp };
+    int scalars_prev[] = { dens_prev, temp_prev };
+    Advect(scalars, scalars_prev, params.temperatureOn ? 2 : 1, xVel, yVel, dt);
+
+    // Temperature stays where it was when not simulated
+    if(!params.temperatureOn){
+        swap(temp_prev, temp);
+    }
+}
@@ -2,6 +2,7 @@
 
 // Preprocessor statements
 #include "headers/StateLoader.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <stdio.h>
@@ -11,7 +12,8 @@ using json = nlohmann::json;
 //// Functions ////
 
 // Load state into existing objects (including params and props)
-void LoadState(const char* jsonFilename, SimState* state, SimParams* params, SimSource* source)
+template<typename Scalar>
+void LoadState(const char* jsonFilename, BasicSimState<Scalar>* state, SimParams* params, BasicSimSource<Scalar>* source)
 {
 
     // Append JSON filename to correct path
@@ -35,7 +37,8 @@ void LoadState(const char* jsonFilename, SimState* state, SimParams* params, Sim
 }
 
 // Load state into existing objects, using params from state
-void LoadState(const char* jsonFilename, SimState* state, SimSource* source)
+template<typename Scalar>
+void LoadState(const char* jsonFilename, BasicSimState<Scalar>* state, BasicSimSource<Scalar>* source)
 {
     // Get params from state
     SimParams* params = &(state->params);
@@ -62,7 +65,8 @@ void LoadParameters(const char* jsonFilename, SimParams* params)
 }
 
 // Load only sources
-void LoadSources(const char* jsonFilename, SimSource* source)
+template<typename Scalar>
+void LoadSources(const char* jsonFilename, BasicSimSource<Scalar>* source)
 {
     // Append JSON filename to correct path
     std::string jsonPath = projectPath + "/src/json/" + jsonFilename + ".json";
@@ -100,10 +104,44 @@ void LoadParams(nlohmann::json json, SimParams* params)
     params->gravityOn            = json["params"]["gravityOn"];
     params->temperatureOn        = json["params"]["temperatureOn"];
     params->solverSteps          = json["params"]["solverSteps"];
+
+    // Later options fall back to their defaults, so older scene files still load
+    const SimParams defaults;
+    params->diffusionSolver      = json["params"].contains("diffusionSolver") ?
+                                   StringToSolver(json["params"]["diffusionSolver"]) : defaults.diffusionSolver;
+    params->pressureSolver       = json["params"].contains("pressureSolver") ?
+                                   StringToSolver(json["params"]["pressureSolver"]) : defaults.pressureSolver;
+    params->numThreads           = json["params"].value("numThreads", defaults.numThreads);
+    params->multigridCycles      = json["params"].value("multigridCycles", defaults.multigridCycles);
+    params->solverTolerance      = json["params"].value("solverTolerance", defaults.solverTolerance);
+    params->solverMaxIterations  = json["params"].value("solverMaxIterations", defaults.solverMaxIterations);
+    params->residualCheckInterval = json["params"].value("residualCheckInterval", defaults.residualCheckInterval);
+    params->warmStartPressure    = json["params"].value("warmStartPressure", defaults.warmStartPressure);
+    params->tileSize             = json["params"].value("tileSize", defaults.tileSize);
+    params->wavefrontSweeps      = json["params"].value("wavefrontSweeps", defaults.wavefrontSweeps);
+    params->hugePages            = json["params"].value("hugePages", defaults.hugePages);
+    params->adaptiveTimeStep     = json["params"].value("adaptiveTimeStep", defaults.adaptiveTimeStep);
+    params->targetCFL            = std::max(0.01f, json["params"].value("targetCFL", defaults.targetCFL));
+    params->maxSubsteps          = std::max(1, json["params"].value("maxSubsteps", defaults.maxSubsteps));
+    params->velocityAdvection    = json["params"].contains("velocityAdvection") ?
+                                   StringToAdvection(json["params"]["velocityAdvection"]) : defaults.velocityAdvection;
+    params->densityAdvection     = json["params"].contains("densityAdvection") ?
+                                   StringToAdvection(json["params"]["densityAdvection"]) : defaults.densityAdvection;
+    params->temperatureAdvection = json["params"].contains("temperatureAdvection") ?
+                                   StringToAdvection(json["params"]["temperatureAdvection"]) : defaults.temperatureAdvection;
+    params->activeRegion         = json["params"].value("activeRegion", defaults.activeRegion);
+    params->activeThreshold      = json["params"].value("activeThreshold", defaults.activeThreshold);
+    params->sparseGrid           = json["params"].value("sparseGrid", defaults.sparseGrid);
+    params->amrLevels            = json["params"].value("amrLevels", defaults.amrLevels);
+    params->amrPatchSize         = json["params"].value("amrPatchSize", defaults.amrPatchSize);
+    params->amrDensity           = json["params"].value("amrDensity", defaults.amrDensity);
+    params->amrGradient          = json["params"].value("amrGradient", defaults.amrGradient);
+    params->amrVorticity         = json["params"].value("amrVorticity", defaults.amrVorticity);
 }
 
 // Load sources
-void LoadSources(nlohmann::json json, SimSource* source)
+template<typename Scalar>
+void LoadSources(nlohmann::json json, BasicSimSource<Scalar>* source)
 {
     // Load sources from file
     nlohmann::json sourceList = json["sources"];
@@ -180,10 +218,57 @@ void LoadSources(nlohmann::json json, SimSource* source)
     source->UpdateSourcesDynamic();
 }
 
+// State and source loaders for each field storage precision
+#define INSTANTIATE_LOADERS(Scalar) \
+    template void LoadState(const char*, BasicSimState<Scalar>*, SimParams*, BasicSimSource<Scalar>*); \
+    template void LoadState(const char*, BasicSimState<Scalar>*, BasicSimSource<Scalar>*); \
+    template void LoadSources(const char*, BasicSimSource<Scalar>*); \
+    template void LoadSources(nlohmann::json, BasicSimSource<Scalar>*);
+
+INSTANTIATE_LOADERS(float)
+INSTANTIATE_LOADERS(double)
+INSTANTIATE_LOADERS(Half)
+INSTANTIATE_LOADERS(BFloat16)
+
+// Load grid resolution, either one size or [x, y] sizes
+void LoadResolution(nlohmann::json json, WindowProps* props)
+{
+    if(json.is_array()){
+        props->xResolution = json[0];
+        props->yResolution = json[1];
+    }else{
+        props->xResolution = json;
+        props->yResolution = json;
+    }
+}
+
+// Load grid resolution directly, from whichever of window or record properties the file has
+void LoadResolution(const char* jsonFilename, WindowProps* props)
+{
+
+    // Append JSON filename to correct path
+    std::string jsonPath = projectPath + "/src/json/" + jsonFilename + ".json";
+
+    // Open file
+    std::ifstream ifs(jsonPath);
+    json j = json::parse(ifs);
+
+    // Load resolution into object
+    if(j.contains("windowProps")){
+        LoadResolution(j["windowProps"]["resolution"], props);
+    }else{
+        LoadResolution(j["recordProps"]["resolution"], props);
+    }
+
+    //  Close filestream
+    ifs.close();
+
+}
+
 // Load window settings
 void LoadWindow(nlohmann::json json, WindowProps* props)
 {
-    props->resolution   = json["windowProps"]["resolution"];
+    LoadResolution(json["windowProps"]["resolution"], props);
     props->winWidth     = json["windowProps"]["winWidth"];
     props->controlWidth = json["windowProps"]["controlWidth"];
     props->maxFrameRate = json["windowProps"]["maxFrameRate"];
@@ -211,7 +296,7 @@ void LoadWindow(const char* jsonFilename, WindowProps* props)
 // Load window settings
 void LoadRecord(nlohmann::json json, WindowProps* props)
 {
-    props->resolution   = json["recordProps"]["resolution"];
+    LoadResolution(json["recordProps"]["resolution"], props);
     props->winWidth     = json["recordProps"]["winWidth"];
     props->fps          = json["recordProps"]["fps"];
     props->numFrames    = json["recordProps"]["numFrames"];
@@ -260,4 +345,27 @@ SimSource::Type StringToType(std::string typeName)
 
     // Default for empty case
     return SimSource::gas;
+}
+
+// Convert string to enum for solver
+SimParams::SolverType StringToSolver(std::string solverName)
+{
+    if(solverName.compare("gaussSeidel") == 0)  { return SimParams::gaussSeidel; }
+    if(solverName.compare("redBlack") == 0)     { return SimParams::redBlack; }
+    if(solverName.compare("multigrid") == 0)    { return SimParams::multigrid; }
+    if(solverName.compare("conjugateGradient") == 0) { return SimParams::conjugateGradient; }
+
+    // Default for empty case
+    return SimParams::gaussSeidel;
+}
+
+// Convert string to enum for advection scheme
+SimParams::AdvectionScheme StringToAdvection(std::string schemeName)
+{
+    if(schemeName.compare("semiLagrangian") == 0) { return SimParams::semiLagrangian; }
+    if(schemeName.compare("macCormack") == 0)     { return SimParams::macCormack; }
+    if(schemeName.compare("bfecc") == 0)          { return SimParams::bfecc; }
+
+    // Default for empty case
+    return SimParams::semiLagrangian;
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+/* Function definition file for worker thread pool */
+
+// Include header definition
+#include "headers/ThreadPool.h"
+
+
+
+//// PUBLIC METHODS ////
+
+// Constructor, spawning all but one worker (the calling thread does a share)
+ThreadPool::ThreadPool(int numThreads)
+{
+    this -> numThreads = numThreads < 1 ? 1 : numThreads;
+    task = nullptr;
+    begin = 0;
+    end = 0;
+    generation = 0;
+    remaining = 0;
+    stopping = false;
+
+    for(int i = 1; i < this -> numThreads; i++){
+        workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+// Destructor, joining all workers
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startCondition.notify_all();
+
+    for(std::thread & worker : workers){
+        worker.join();
+    }
+}
+
+// Run task over [begin, end), split into one contiguous chunk per thread
+void ThreadPool::ParallelFor(int begin, int end, const std::function<void(int, int)> & task)
+{
+    // Skip synchronization entirely when running single threaded
+    if(numThreads == 1 || end - begin < numThreads){
+        task(begin, end);
+        return;
+    }
+
+    // Publish task to workers
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this -> task = &task;
+        this -> begin = begin;
+        this -> end = end;
+        remaining = numThreads - 1;
+        generation++;
+    }
+    startCondition.notify_all();
+
+    // Calling thread takes the first chunk
+    RunChunk(0);
+
+    // Wait for workers to finish their chunks
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this]{ return remaining == 0; });
+    this -> task = nullptr;
+}
+
+// Get number of threads, including the calling thread
+int ThreadPool::NumThreads()
+{
+    return numThreads;
+}
+
+
+//// PRIVATE METHODS ////
+
+// Wait for tasks and run assigned chunk
+void ThreadPool::WorkerLoop(int worker)
+{
+    unsigned int lastGeneration = 0;
+
+    while(true){
+
+        // Wait for next task or shutdown
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCondition.wait(lock, [&]{ return stopping || generation != lastGeneration; });
+            if(stopping){
+                return;
+            }
+            lastGeneration = generation;
+        }
+
+        RunChunk(worker);
+
+        // Report completion
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            remaining--;
+        }
+        doneCondition.notify_one();
+    }
+}
+
+// Run fixed chunk of range, so partitioning is the same on every call
+void ThreadPool::RunChunk(int chunk)
+{
+    int length = end - begin;
+    int chunkStart = begin + (length * chunk) / numThreads;
+    int chunkEnd   = begin + (length * (chunk + 1)) / numThreads;
+
+    if(chunkEnd > chunkStart){
+        (*task)(chunkStart, chunkEnd);
+    }
+}
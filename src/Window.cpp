@@ -16,11 +16,13 @@ std::string defaultJSON = "match";
 ShaderVars shaderVars;
 
 // Window size properties
-int resolution;
+int resolution[2];
 int winWidth;
+int winHeight;
 int wMargin = 0;
 int hMargin = 0;
 int texWidth;
+int texHeight;
 int texSize;
 int controlWidth;
 float bottomPos;
@@ -45,11 +47,17 @@ void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
     // Save lower limit
     bottomPos = float(height);
 
-    // Resize window with simulation centered in window
-    winWidth = std::min(width - controlWidth, height);
+    // Resize window with simulation centered in window, keeping cells square
+    float aspect = float(texHeight - 2) / (texWidth - 2);
+    winWidth = width - controlWidth;
+    winHeight = int(round(winWidth * aspect));
+    if(winHeight > height){
+        winHeight = height;
+        winWidth = int(round(height / aspect));
+    }
     wMargin = (width - controlWidth - winWidth) / 2;
-    hMargin = (height - winWidth) / 2;
-    glViewport(wMargin, hMargin, winWidth, winWidth);
+    hMargin = (height - winHeight) / 2;
+    glViewport(wMargin, hMargin, winWidth, winHeight);
 
     // Resize control panel
     controlPos = ImVec2(float(width - controlWidth), 0.0);
@@ -86,13 +94,16 @@ void ScrollCallback(GLFWwindow* window, double xOffset, double yOffset)
 }
 
 // OpenGL environment and background setup for simulation display
-GLFWwindow* SimWindowSetup(int N, int windowWidth)
+GLFWwindow* SimWindowSetup(int xRes, int yRes, int windowWidth)
 {
     // Save parameters
-    resolution = N;
+    resolution[0] = xRes;
+    resolution[1] = yRes;
     winWidth = windowWidth;
-    texWidth = N + 2;
-    texSize = texWidth * texWidth;
+    winHeight = int(round(windowWidth * float(yRes) / xRes));
+    texWidth = xRes + 2;
+    texHeight = yRes + 2;
+    texSize = texWidth * texHeight;
 
     // Set up OpenGL state
     if(!glfwInit()){
@@ -106,7 +117,7 @@ GLFWwindow* SimWindowSetup(int N, int windowWidth)
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     // Set up main window
-    GLFWwindow* window = glfwCreateWindow(windowWidth, windowWidth, "Fluid Simulator", NULL, NULL);
+    GLFWwindow* window = glfwCreateWindow(winWidth, winHeight, "Fluid Simulator", NULL, NULL);
     if(window == NULL){ 
         fprintf(stderr, "GLFW failed to create window."); 
         glfwTerminate();
@@ -120,9 +131,9 @@ GLFWwindow* SimWindowSetup(int N, int windowWidth)
     }
     
     // Set up viewing window
-    glViewport(0, 0, windowWidth, windowWidth);
+    glViewport(0, 0, winWidth, winHeight);
     glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
-    FramebufferSizeCallback(window, windowWidth, windowWidth);
+    FramebufferSizeCallback(window, winWidth, winHeight);
 
     // Set input callbacks
     glfwSetKeyCallback(window, KeyCallback);
@@ -145,26 +156,9 @@ GLFWwindow* SimWindowSetup(int N, int windowWidth)
     glGenVertexArrays(1, &VAO);
     glBindVertexArray(VAO);
 
-    // Calculate the limits of visible data
-    float uvMin = 1.0 / float(texWidth);
-    float uvMax = 1.0 - uvMin;
-
     // Copy vertices of full sized quad into buffer
-    float vertices[] = {
-        // Position             // UV coordinates
-         1.0f,  1.0f, -1.0f,     uvMax, uvMax,
-         1.0f, -1.0f, -1.0f,     uvMax, uvMin,
-        -1.0f, -1.0f, -1.0f,     uvMin, uvMin,
-        -1.0f,  1.0f, -1.0f,     uvMin, uvMax,
-         1.0f,  1.0f,  0.0f,      1.0f,  0.0f,
-         1.0f, -1.0f,  0.0f,      1.0f,  1.0f,
-        -1.0f, -1.0f,  0.0f,      0.0f,  1.0f,
-        -1.0f,  1.0f,  0.0f,      0.0f,  0.0f
-
-    };
     glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    SetQuadVertices();
 
     // Set up vertex attributes
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
@@ -196,8 +190,13 @@ GLFWwindow* SimWindowSetup(int N, int windowWidth)
 }
 
 // Processes to be called each frame for simulation window
-void SimWindowRenderLoop(GLFWwindow* window, float* density, float* temperature)
+void SimWindowRenderLoop(GLFWwindow* window, SimState* state)
 {
+    // Fluid temperature shading reads the temperature of the mixed fluid, as cached by
+    // the simulation, and others the gas temperature itself
+    float* density = state->fields.dens;
+    float* temperature = shaderParam == 4 ? state->GetMixedTemperature() : state->fields.temp;
+
     // Clear background color
     glBlendFunc(GL_ONE, GL_ZERO);
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
@@ -211,10 +210,10 @@ void SimWindowRenderLoop(GLFWwindow* window, float* density, float* temperature)
 
     // Bind texture
     glActiveTexture(GL_TEXTURE0);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, texWidth, texWidth, 0, GL_RED, GL_FLOAT, density);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, texWidth, texHeight, 0, GL_RED, GL_FLOAT, density);
     glBindTexture(GL_TEXTURE_2D, densTex);
     glActiveTexture(GL_TEXTURE1);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, texWidth, texWidth,  0, GL_RED, GL_FLOAT, temperature);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, texWidth, texHeight, 0, GL_RED, GL_FLOAT, temperature);
     glBindTexture(GL_TEXTURE_2D, tempTex);
 
     // Render quad of triangles
@@ -242,7 +241,7 @@ void SetupTextures()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
     float borderColor[] = {0.0f, 0.0f, 0.0f, 1.0f};
     glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, texWidth, texWidth, 0, GL_RED, GL_FLOAT, blank);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, texWidth, texHeight, 0, GL_RED, GL_FLOAT, blank);
 
     // Set up temperature texture
     glGenTextures(1, &tempTex);
@@ -252,7 +251,7 @@ void SetupTextures()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
     glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, texWidth, texWidth, 0, GL_RED, GL_FLOAT, blank);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, texWidth, texHeight, 0, GL_RED, GL_FLOAT, blank);
 
     // Assign texture units
     for(int i = 0; i < numShaders; i++){
@@ -262,6 +261,47 @@ void SetupTextures()
     }
 }
 
+// Copy simulation and cursor quads into vertex buffer for current texture size
+void SetQuadVertices()
+{
+    // Calculate the limits of visible data
+    float uMin = 1.0 / float(texWidth);
+    float uMax = 1.0 - uMin;
+    float vMin = 1.0 / float(texHeight);
+    float vMax = 1.0 - vMin;
+
+    float vertices[] = {
+        // Position             // UV coordinates
+         1.0f,  1.0f, -1.0f,     uMax, vMax,
+         1.0f, -1.0f, -1.0f,     uMax, vMin,
+        -1.0f, -1.0f, -1.0f,     uMin, vMin,
+        -1.0f,  1.0f, -1.0f,     uMin, vMax,
+         1.0f,  1.0f,  0.0f,      1.0f,  0.0f,
+         1.0f, -1.0f,  0.0f,      1.0f,  1.0f,
+        -1.0f, -1.0f,  0.0f,      0.0f,  1.0f,
+        -1.0f,  1.0f,  0.0f,      0.0f,  0.0f
+
+    };
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+}
+
+// Match textures and viewport to a simulation grid that has been resized
+void ResizeSimWindow(GLFWwindow* window, int xRes, int yRes)
+{
+    resolution[0] = xRes;
+    resolution[1] = yRes;
+    texWidth = xRes + 2;
+    texHeight = yRes + 2;
+    texSize = texWidth * texHeight;
+    SetQuadVertices();
+
+    // Refit viewport to new aspect ratio
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    FramebufferSizeCallback(window, width, height);
+}
+
 // Create control window for already active OpenGL environment
 void ControlWindowSetup(GLFWwindow* window, int controlPanelWidth)
 {
@@ -304,8 +344,9 @@ void ControlWindowRenderLoop(GLFWwindow* window, SimState* state, SimSource* sou
     SourceGUI(window, state, source);
     ShaderGUI();
     ResetGUI(state, source);
-    WindowGUI(state, source, props, timer);
+    WindowGUI(state, props, timer);
     FramerateGUI(timer);
+    SolverStatsGUI(state);
 
     // Render ImGui frame
     ImGui::End();
@@ -507,41 +548,20 @@ void ResetGUI(SimState* state, SimSource* source)
 }
 
 // GUI for window control
-void WindowGUI(SimState* state, SimSource* source, WindowProps* props, SimTimer* timer)
+void WindowGUI(SimState* state, WindowProps* props, SimTimer* timer)
 {
     ImGui::Text("Simulation Resolution:");
     ImGui::SameLine();
     ImGui::TextDisabled("(?)");
     if(ImGui::IsItemHovered()){
         ImGui::BeginTooltip();
-        ImGui::TextUnformatted("Resizes the simulation grid to N x N, where N is the resolution value");
+        ImGui::TextUnformatted("Resizes the simulation grid to Nx x Ny cells; the current flow is interpolated onto the new grid");
         ImGui::EndTooltip(); }
-    ImGui::InputInt("##N", &resolution);
-    if(ImGui::Button("Resize", ImVec2(80.0, 20.0))){
-
-        // Resize shader texture sizes
-        texWidth = resolution + 2;
-        texSize = texWidth * texWidth;
-
-        // Calculate the limits of visible data
-        float uvMin = 1.0 / float(texWidth);
-        float uvMax = 1.0 - uvMin;
-
-        // Copy vertices of full sized quad into buffer
-        float vertices[] = {
-            // Position             // UV coordinates
-            1.0f,  1.0f, 0.0f,     uvMax, uvMax,
-            1.0f, -1.0f, 0.0f,     uvMax, uvMin,
-            -1.0f, -1.0f, 0.0f,     uvMin, uvMin,
-            -1.0f,  1.0f, 0.0f,     uvMin, uvMax
-        };
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-        // Resize simulation objects
-        state -> ResizeGrid(resolution);
-        source -> Reset();
-        LoadSources(const_cast<char*>(defaultJSON.c_str()), source);
+    ImGui::InputInt2("##N", resolution);
+    if(ImGui::Button("Resize", ImVec2(80.0, 20.0)) && resolution[0] > 0 && resolution[1] > 0){
+
+        // Allocate new grid in background, swapped in once ready
+        state -> RequestResize(resolution[0], resolution[1]);
     }
 
     ImGui::Text("Framerate Cap:");
@@ -555,9 +575,125 @@ void WindowGUI(SimState* state, SimSource* source, WindowProps* props, SimTimer*
         }
     }
 
+    ImGui::Checkbox("Adaptive Time Step", &(state -> params.adaptiveTimeStep));
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if(ImGui::IsItemHovered()){
+        ImGui::BeginTooltip();
+        ImGui::TextUnformatted("Splits each frame into the fewest substeps that keep the CFL number (cells crossed per substep) under the target");
+        ImGui::EndTooltip(); }
+    if(state -> params.adaptiveTimeStep){
+        ImGui::Text("Target CFL:");
+        ImGui::InputFloat("##targetcfl", &(state -> params.targetCFL), 0.1, 1.0, "%.2f");
+        state -> params.targetCFL = std::max(0.01f, state -> params.targetCFL);
+        ImGui::Text("Max Substeps:");
+        ImGui::InputInt("##maxsubsteps", &(state -> params.maxSubsteps));
+        state -> params.maxSubsteps = std::max(1, state -> params.maxSubsteps);
+    }
+
+    ImGui::Text("Advection:");
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if(ImGui::IsItemHovered()){
+        ImGui::BeginTooltip();
+        ImGui::TextUnformatted("MacCormack and BFECC correct the smearing of semi-Lagrangian advection, keeping detail at lower resolution\nMacCormack costs about two advections per step, BFECC about three");
+        ImGui::EndTooltip(); }
+    SimParams::AdvectionScheme* schemes[] = { &(state -> params.velocityAdvection), &(state -> params.densityAdvection), &(state -> params.temperatureAdvection) };
+    const char* schemeLabels[] = {
+        "Velocity: Semi-Lagrangian\0Velocity: MacCormack\0Velocity: BFECC\0",
+        "Density: Semi-Lagrangian\0Density: MacCormack\0Density: BFECC\0",
+        "Temperature: Semi-Lagrangian\0Temperature: MacCormack\0Temperature: BFECC\0"
+    };
+    for(int f = 0; f < 3; f++){
+        int scheme = *schemes[f];
+        ImGui::PushID(f);
+        if(ImGui::Combo("##advection", &scheme, schemeLabels[f])){
+            *schemes[f] = static_cast<SimParams::AdvectionScheme>(scheme);
+        }
+        ImGui::PopID();
+    }
+
+    ImGui::Checkbox("Active Region", &(state -> params.activeRegion));
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if(ImGui::IsItemHovered()){
+        ImGui::BeginTooltip();
+        ImGui::TextUnformatted("Skips sources, decay, buoyancy, and advection outside the box around cells whose density, velocity, or temperature departs from rest by more than the threshold\nDiffusion and pressure are still solved over the whole grid");
+        ImGui::EndTooltip(); }
+    if(state -> params.activeRegion){
+        ImGui::Text("Active Threshold:");
+        ImGui::InputFloat("##activethreshold", &(state -> params.activeThreshold), 0.0001, 0.001, "%.5f");
+        state -> params.activeThreshold = std::max(0.0f, state -> params.activeThreshold);
+    }
+
     ImGui::Text("Solver Steps:");
     ImGui::InputInt("##solvesteps", &(state -> params.solverSteps));
 
+    ImGui::Text("Solvers:");
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if(ImGui::IsItemHovered()){
+        ImGui::BeginTooltip();
+        ImGui::TextUnformatted("Red-Black sweeps the grid as a checkerboard, splitting each color across the solver threads\nMultigrid solves pressure on a hierarchy of coarser grids, with cycles in place of steps\nConjugate Gradient iterates until the residual falls below the tolerance");
+        ImGui::EndTooltip(); }
+
+    // Diffusion has no multigrid option, so map combo entries to solvers
+    static const SimParams::SolverType diffusionSolvers[] = { SimParams::gaussSeidel, SimParams::redBlack, SimParams::conjugateGradient };
+    int diffusionSolver = state -> params.diffusionSolver == SimParams::conjugateGradient ? 2 : state -> params.diffusionSolver;
+    if(ImGui::Combo("##diffsolver", &diffusionSolver, "Diffusion: Gauss-Seidel\0Diffusion: Red-Black\0Diffusion: Conjugate Gradient\0")){
+        state -> params.diffusionSolver = diffusionSolvers[diffusionSolver];
+    }
+    int pressureSolver = state -> params.pressureSolver;
+    if(ImGui::Combo("##pressolver", &pressureSolver, "Pressure: Gauss-Seidel\0Pressure: Red-Black\0Pressure: Multigrid\0Pressure: Conjugate Gradient\0")){
+        state -> params.pressureSolver = static_cast<SimParams::SolverType>(pressureSolver);
+    }
+    if(state -> params.pressureSolver == SimParams::multigrid){
+        ImGui::Text("Multigrid Cycles:");
+        ImGui::InputInt("##mgcycles", &(state -> params.multigridCycles));
+        state -> params.multigridCycles = std::max(1, state -> params.multigridCycles);
+    }
+    ImGui::Text("Residual Check Interval:");
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if(ImGui::IsItemHovered()){
+        ImGui::BeginTooltip();
+        ImGui::TextUnformatted("Sweeps between residual checks, stopping once below the tolerance (0 always runs every step)");
+        ImGui::EndTooltip(); }
+    ImGui::InputInt("##rescheck", &(state -> params.residualCheckInterval));
+    state -> params.residualCheckInterval = std::max(0, state -> params.residualCheckInterval);
+    if(state -> params.pressureSolver == SimParams::conjugateGradient
+    || state -> params.diffusionSolver == SimParams::conjugateGradient
+    || state -> params.residualCheckInterval > 0){
+        ImGui::Text("Solver Tolerance:");
+        ImGui::InputFloat("##soltolerance", &(state -> params.solverTolerance), 0.00001, 0.001, "%.3e");
+        ImGui::Text("Max Iterations:");
+        ImGui::InputInt("##solmaxiter", &(state -> params.solverMaxIterations));
+    }
+    ImGui::Checkbox("Warm Start Pressure", &(state -> params.warmStartPressure));
+    if(state -> params.diffusionSolver == SimParams::gaussSeidel
+    || state -> params.pressureSolver == SimParams::gaussSeidel){
+        ImGui::Text("Tile Size:");
+        ImGui::SameLine();
+        ImGui::TextDisabled("(?)");
+        if(ImGui::IsItemHovered()){
+            ImGui::BeginTooltip();
+            ImGui::TextUnformatted("Gauss-Seidel sweeps the grid in square tiles of this many cells across (0 sweeps whole rows)");
+            ImGui::EndTooltip(); }
+        ImGui::InputInt("##tilesize", &(state -> params.tileSize));
+        state -> params.tileSize = std::max(0, state -> params.tileSize);
+        ImGui::Text("Wavefront Sweeps:");
+        ImGui::SameLine();
+        ImGui::TextDisabled("(?)");
+        if(ImGui::IsItemHovered()){
+            ImGui::BeginTooltip();
+            ImGui::TextUnformatted("Gauss-Seidel sweeps applied together in one pass over the grid, with the same result as separate sweeps (1 sweeps one at a time)");
+            ImGui::EndTooltip(); }
+        ImGui::InputInt("##wavefront", &(state -> params.wavefrontSweeps));
+        state -> params.wavefrontSweeps = std::max(1, state -> params.wavefrontSweeps);
+    }
+    ImGui::Text("Solver Threads:");
+    ImGui::InputInt("##solvethreads", &(state -> params.numThreads));
+
     ImGui::Text("");
     ImGui::Separator();
 }
@@ -669,7 +805,7 @@ void SourceGUI(GLFWwindow* window, SimState* state, SimSource* source)
         double xpos, ypos;
         glfwGetCursorPos(window, &xpos, &ypos);
         float xposScreen = (2 * (float(xpos) - wMargin) / winWidth) - 1.0;
-        float yposScreen = -1 * ((2 * (float(ypos) - hMargin) / winWidth) - 1.0);
+        float yposScreen = -1 * ((2 * (float(ypos) - hMargin) / winHeight) - 1.0);
 
         if((abs(xposScreen) < 1.0) && (abs(yposScreen) < 1.0)){
             if(dynamic){
@@ -725,7 +861,7 @@ void SourceGUI(GLFWwindow* window, SimState* state, SimSource* source)
         double xpos, ypos;
         glfwGetCursorPos(window, &xpos, &ypos);
         float xposScreen = (2 * (float(xpos) - wMargin) / winWidth) - 1.0;
-        float yposScreen = -1 * ((2 * (float(ypos) - hMargin) / winWidth) - 1.0);
+        float yposScreen = -1 * ((2 * (float(ypos) - hMargin) / winHeight) - 1.0);
 
         source->RemoveSourceAtPoint(xposScreen, yposScreen, 0.05);
     }
@@ -748,7 +884,8 @@ void DrawCursor(GLFWwindow* window)
         shaders[6].SetInt("shape", cursorShape);
         shaders[6].SetFloat("size", cursorSize);
         shaders[6].SetFloat("xPos", (float(xpos) - wMargin) / winWidth);
-        shaders[6].SetFloat("yPos", (float(ypos) - hMargin) / winWidth);
+        shaders[6].SetFloat("yPos", (float(ypos) - hMargin) / winHeight);
+        shaders[6].SetFloat("aspect", float(winHeight) / winWidth);
 
         // Draw squares then reset shader
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void *) (6 * sizeof(unsigned int)));
@@ -760,4 +897,29 @@ void FramerateGUI(SimTimer* timer)
 {
     // FPS readout
     ImGui::Text("Current FPS: %f \nAverage FPS: %f", timer->CurrentFrameRate(), timer->AverageFrameRate());
+}
+
+// GUI for solver convergence of last step
+void SolverStatsGUI(SimState* state)
+{
+    const char* names[SimState::numSolves] = { "Pressure", "X Velocity", "Y Velocity", "Density", "Temperature" };
+
+    ImGui::Text("");
+    ImGui::Text("Solver Iterations / Residual:");
+    for(int s = 0; s < SimState::numSolves; s++){
+        SolveStats stats = state->GetSolveStats(static_cast<SimState::SolveType>(s));
+        if(stats.residual < 0){
+            ImGui::Text("%s: %d / -", names[s], stats.iterations);
+        }else{
+            ImGui::Text("%s: %d / %.2e", names[s], stats.iterations, stats.residual);
+        }
+    }
+
+    if(state -> params.adaptiveTimeStep){
+        ImGui::Text("Substeps / CFL: %d / %.2f", state -> GetSubsteps(), state -> GetCFL());
+    }
+
+    if(state -> params.activeRegion){
+        ImGui::Text("Active Cells: %.1f%%", 100 * state -> GetActiveFraction());
+    }
 }
\ No newline at end of file
@@ -0,0 +1,104 @@
+/* Header file for adaptive mesh refinement over a simulation */
+
+// Preprocessor statements
+#ifndef AMRSTATE_H
+#define AMRSTATE_H
+
+// Include statements
+#include <vector>
+#include "SimState.h"
+#include "ThreadPool.h"
+
+// Quadtree of refined patches over a base simulation. A patch of level l covers a
+// square of amrPatchSize / 2^l base cells with amrPatchSize cells across, so each level
+// halves the cell size, and has the four patches of the next level over its quadrants
+// as children. Each patch is an ordinary SimState with a ring of buffer cells around
+// the square it covers, solving the flow at its own cell size with the ghost cells of
+// that ring held as they are filled; buffers and squares stop at walls of the base,
+// which the patch evaluates as the base does. Before every step the buffer is copied
+// from patches of the same level where they cover it and interpolated from the parent
+// level elsewhere, all from fields as they stand before any grid steps. Levels then
+// step in turn from the base, each patch taking pressure at its edges from its parent
+// once that has stepped, and after the step density, temperature and velocity of each
+// patch are averaged back into its parent, finest level first.
+// Patches are kept where density, its gradient, or vorticity of their parent passes
+// the amr thresholds, which are compared per cell of the parent so refinement stops
+// once fields are smooth on the finer cells
+class AMRState
+{
+    public:
+
+        // Constructors, refining a simulation owned by the caller
+        AMRState(SimState * base);
+        ~AMRState();
+
+        // Public methods
+        void SimulationStep(float timeStep);
+        void ResetState();
+        void Regrid();
+
+        // Patch accessors
+        SimState * Base();
+        int GetLevels();
+        int GetPatches(int level);
+
+    private:
+
+        // Refined square of the domain, with its parent one level coarser (none for
+        // patches of level 1, whose parent is the base) and children one level finer
+        struct Patch
+        {
+            int level;
+            int x;
+            int y;
+            SimState * state;
+            Patch * parent;
+            Patch * children[4];
+        };
+
+        // Placement of a grid in the domain, in base cells: the corner of its first
+        // cell, its cell size, and its cells within the square a patch covers
+        struct Frame
+        {
+            float x;
+            float y;
+            float h;
+            int iStart;
+            int jStart;
+            int iEnd;
+            int jEnd;
+        };
+
+        // Simulation refined, and patches of each level with their positions indexed
+        SimState * base;
+        std::vector<std::vector<Patch *>> patches;
+        std::vector<std::vector<Patch *>> table;
+
+        // Cells across the square of a patch, and its buffer width
+        int patchSize;
+        int bufferSize;
+
+        // Worker threads, stepping patches side by side
+        ThreadPool * threadPool;
+
+        // Private methods
+        Patch * CreatePatch(int level, int x, int y, Patch * parent);
+        void DeletePatch(Patch * patch);
+        void FillFromParent(Patch * patch, bool interior);
+        void FillPressureFromParent(Patch * patch);
+        void RestrictToParent(Patch * patch);
+        Patch * FindPatch(int level, float X, float Y);
+        bool NeedsRefinement(SimState * state, int iStart, int iEnd, int jStart, int jEnd);
+        SimParams PatchParams(int level, int Nx);
+        float PatchExtent(int level);
+        int PatchesAcross(int level, int N);
+        int PatchCells(int level, int x, int N, int & start, int & end);
+        Frame PatchFrame(Patch * patch);
+        Frame ParentFrame(Patch * patch);
+        Frame BaseFrame();
+        SimState * ParentState(Patch * patch);
+        float Sample(float * x, int Nx, int Ny, const Frame & frame, float X, float Y);
+};
+
+// Preprocessor close statement
+#endif
@@ -0,0 +1,37 @@
+/* Header file for semi-Lagrangian advection kernels */
+
+// Preprocessor statements
+#ifndef ADVECTION_H
+#define ADVECTION_H
+
+// Include statements
+#include "Lanes.h"
+
+// Advect interior cells [iStart, iEnd) of rows [jStart, jEnd) of each field d[f] from d0[f]
+// along velocity (u, v) on an Nx by Ny grid, with dt0 the time step in cells; departure
+// points are shared by all fields, and ghost cells are left to the caller
+typedef void (*AdvectRowsKernel)(float ** d, float ** d0, int count, float * u, float * v, float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd);
+
+// Kernels for each instruction set, the portable one also for fields stored as double,
+// Half, or BFloat16, and one for ensembles stepping a simulation in each lane
+template<typename T>
+void AdvectRowsScalar(T ** d, T ** d0, int count, float * u, float * v, float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd);
+template<int K>
+void AdvectRowsLanes(Lanes<float, K> ** d, Lanes<float, K> ** d0, int count, Lanes<float, K> * u, Lanes<float, K> * v,
+                     float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd);
+void AdvectRowsAVX2(float ** d, float ** d0, int count, float * u, float * v, float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd);
+void AdvectRowsAVX512(float ** d, float ** d0, int count, float * u, float * v, float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd);
+
+// Clamp the same cells of each field d[f] to the four samples of d0[f] that
+// the departure point along (u, v) interpolates from, limiting higher order schemes
+template<typename T>
+void ClampRowsScalar(T ** d, T ** d0, int count, float * u, float * v, float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd);
+template<int K>
+void ClampRowsLanes(Lanes<float, K> ** d, Lanes<float, K> ** d0, int count, Lanes<float, K> * u, Lanes<float, K> * v,
+                    float dt0, int Nx, int Ny, int iStart, int iEnd, int jStart, int jEnd);
+
+// Fastest kernel supported by this CPU
+AdvectRowsKernel SelectAdvectRows();
+
+// Preprocessor close statement
+#endif
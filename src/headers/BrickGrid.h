@@ -0,0 +1,92 @@
+/* Header file for sparse grids stored in bricks */
+
+// Preprocessor statements
+#ifndef BRICKGRID_H
+#define BRICKGRID_H
+
+// Include statements
+#include <cstddef>
+#include <vector>
+
+// Planes of an Nx by Ny grid stored in square bricks of cells, allocated only where
+// some plane departs from its background value. A table maps each brick position to
+// its slot in the pool, and cells of missing bricks read as background, so memory
+// follows the occupied area rather than the grid size. Ghost cells along the walls
+// read as SetBoundary in SimState would set them, for planes given walls, and cells
+// beyond read as background
+class BrickGrid
+{
+    public:
+
+        // Cells along each side of a brick, and in a brick including its halo
+        static constexpr int brickSize = 16;
+        static constexpr int haloSize = brickSize + 2;
+
+        // Constructor, with the background value of each plane
+        BrickGrid(int Nx, int Ny, const std::vector<float> & background);
+
+        // Brick table
+        int Lookup(int bi, int bj);
+        int Activate(int bi, int bj);
+        void Release(int slot);
+        const std::vector<int> & ActiveBricks();
+
+        // Brick position and cells of a slot
+        int BrickX(int slot);
+        int BrickY(int slot);
+        float * Cells(int plane, int slot);
+
+        // Cell access, allocating on write
+        float Get(int plane, int i, int j);
+        void Set(int plane, int i, int j, float value);
+        float Sample(int plane, float x, float y);
+        void GatherHalo(int plane, int slot, float * halo);
+
+        // Background values
+        float GetBackground(int plane);
+        void SetBackground(int plane, float value);
+
+        // Boundary conditions of plane at the walls, by the b of SetBoundary in SimState,
+        // or noWalls (the default) for ghost cells reading as background
+        static constexpr int noWalls = -2;
+        void SetWalls(int plane, int b);
+
+        // Grid size accessors
+        int GetNx();
+        int GetNy();
+        int GetBricksX();
+        int GetBricksY();
+        size_t GetMemory();
+
+    private:
+
+        // Grid size, in interior cells and in bricks
+        int Nx;
+        int Ny;
+        int bricksX;
+        int bricksY;
+
+        // Planes held by each brick, their value where no brick is allocated, and
+        // their boundary conditions
+        int numPlanes;
+        std::vector<float> background;
+        std::vector<int> walls;
+
+        // Slot of each brick position (-1 where unallocated) and position of each slot
+        std::vector<int> table;
+        std::vector<int> slotBrick;
+
+        // Cells of every slot, plane by plane, with released slots kept for reuse
+        std::vector<float> pool;
+        std::vector<int> freeSlots;
+
+        // Allocated slots, in order of allocation
+        std::vector<int> active;
+        std::vector<int> activeIndex;
+
+        // Value of a cell outside the interior
+        float Ghost(int plane, int i, int j);
+};
+
+// Preprocessor close statement
+#endif
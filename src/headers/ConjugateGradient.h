@@ -0,0 +1,65 @@
+/* Header file for preconditioned conjugate gradient solver */
+
+// Preprocessor statements
+#ifndef CONJUGATEGRADIENT_H
+#define CONJUGATEGRADIENT_H
+
+// Include statements
+#include "ThreadPool.h"
+
+// Matrix-free Jacobi-preconditioned conjugate gradient solver for
+// (shift + 4) x - (sum of neighbors) = rhs, with ghost cells set by SetBoundary
+class ConjugateGradient
+{
+    public:
+
+        // Constructor and destructor
+        ConjugateGradient(int Nx, int Ny, ThreadPool* threadPool);
+        ~ConjugateGradient();
+
+        // Public methods
+        int Solve(int b, float * x, float * rhs, float * shift, float tolerance, int maxIterations);
+
+        // Scratch arrays for callers to build shift and right-hand side into
+        float * Shift();
+        float * Rhs();
+
+        // Public accessors
+        int GetNx();
+        int GetNy();
+        float LastResidual();
+
+    private:
+
+        // Grid size
+        int Nx;
+        int Ny;
+        int size;
+
+        // Worker threads shared with simulation state
+        ThreadPool* threadPool;
+
+        // Work arrays
+        float * r;
+        float * z;
+        float * d;
+        float * q;
+        float * shift;
+        float * rhs;
+
+        // Per-row partial sums, reduced in order for reproducibility
+        double * rowSums;
+        double * rowSumsAlt;
+
+        // Relative residual at end of last solve
+        float lastResidual;
+
+        // Private methods
+        double ApplyOperator(int b, float * x, float * Ax, float * shift);
+        double Dot(float * x, float * y);
+        double SumRows(double * sums);
+        void RemoveMean(float * x);
+};
+
+// Preprocessor close statement
+#endif
@@ -0,0 +1,155 @@
+/* Header file for simulations split across MPI processes */
+
+// Preprocessor statements
+#ifndef DISTRIBUTEDSIMSTATE_H
+#define DISTRIBUTEDSIMSTATE_H
+
+// Include statements
+#include <mpi.h>
+#include <functional>
+#include <vector>
+#include "SimSource.h"
+#include "SimState.h"
+
+// Simulation on a grid split into slabs of rows, one slab per MPI process. Each
+// process holds its rows with a ghost row above and below, which either lie beyond a
+// wall, and are set as SetBoundary does in SimState, or are halo rows copied from the
+// neighboring process, exchanged wherever SetBoundary runs in SimState. Relaxation
+// sweeps update the edge rows of a slab first, send them while updating the inner rows,
+// and only wait for the halos before the next sweep. Advection never reaches past the
+// neighboring row, as steps are split so flow crosses at most one cell per substep, and
+// sums over the grid add rows in order as in SimState, so results do not depend on the
+// number of processes. Diffusion and pressure relax by red-black sweeps and advection is
+// semi-Lagrangian, while coefficients follow advancedCoefficients as in SimState, each
+// cell reading only its own density and temperature
+class DistributedSimState
+{
+    public:
+
+        // Constructors, collective over comm
+        DistributedSimState(int N, SimParams params, MPI_Comm comm = MPI_COMM_WORLD);
+        DistributedSimState(int Nx, int Ny, SimParams params, MPI_Comm comm = MPI_COMM_WORLD);
+        ~DistributedSimState();
+
+        // Public methods, all collective
+        void SimulationStep(float timeStep);
+        void SetSources(SimSource * source);
+        void GatherDensity(float * density, int root = 0);
+        void ResetState();
+        double TotalDensity();
+
+        // Grid size accessors
+        int GetNx();
+        int GetNy();
+
+        // Process accessors, with the first global row and number of rows held here
+        int GetRank();
+        int GetRanks();
+        int GetRowStart();
+        int GetRows();
+
+        // Substeps and largest CFL number of the last step
+        int GetSubsteps();
+        float GetCFL();
+
+        // Simulation parameters
+        SimParams params;
+
+    private:
+
+        // Communicator, this process and those holding the rows below and above
+        // (MPI_PROC_NULL beyond the walls)
+        MPI_Comm comm;
+        int rank;
+        int ranks;
+        int below;
+        int above;
+
+        // Global grid size, first global row held here, and rows held
+        int Nx;
+        int Ny;
+        int rowStart;
+        int rows;
+        int size;
+
+        // Rows held by every process, and their offsets in the grid
+        std::vector<int> rowCounts;
+        std::vector<int> rowOffsets;
+
+        // Current, previous, and source fields, then pressure, divergence, and diffusion
+        // coefficients
+        std::vector<float> planes;
+        float * xVel;
+        float * yVel;
+        float * dens;
+        float * temp;
+        float * xVel_prev;
+        float * yVel_prev;
+        float * dens_prev;
+        float * temp_prev;
+        float * xVel_source;
+        float * yVel_source;
+        float * dens_source;
+        float * temp_source;
+        float * pres;
+        float * pres_advect;
+        float * div;
+        float * visc_coeff;
+        float * diff_coeff;
+        float * diffTemp_coeff;
+
+        // Halo exchanges in flight
+        std::vector<MPI_Request> requests;
+
+        // Physical constants, and stats of the last step
+        PhysicalConstants<float> constants;
+        int substeps;
+        float cfl;
+
+        // Halo exchange and walls
+        void StartExchange(float * x);
+        void FinishExchange();
+        template<int b>
+        void SetWalls(float * x);
+        template<int b>
+        void SetBoundary(float * x);
+
+        // Reductions over every process
+        double RowSum(const std::function<double(int)> & rowValue);
+        float MaxSpeed();
+
+        // Row updates with the halo exchange of the planes written overlapping the inner
+        // rows, and red-black sweeps of one color built on them
+        template<typename Update>
+        void UpdateRows(float ** x, int count, const Update & update);
+        template<typename Relax>
+        void Sweep(float * x, int color, const Relax & relax);
+
+        // Private methods
+        void DispatchStep(float dt);
+        void UpdateCoefficients();
+        void UpdateThermalCoefficients();
+        void AddSource(float * x, float * s, float dt);
+        void AddHeatSource(float * t, float * s);
+        void Dissipate(float * x, float eqVal, float rate, float fallOff, float dt);
+        void Convect(float dt);
+        template<int b>
+        void Diffuse(float * x, float * x0, float * coeff, float dt);
+        void HodgeProjection(float * u, float * v, float * p);
+        void RelaxPressure(float * p);
+        float PressureResidual(float * p, double rhsNorm);
+        void RemoveMean(float * x);
+        void Advect(float ** d, float ** d0, int count, float * u, float * v, float dt);
+
+        // Collected steps
+        template<bool closed>
+        void VelocityStep(float dt);
+        template<bool closed>
+        void DensityStep(float dt);
+        void TemperatureStep(float dt);
+        template<bool closed>
+        void ScalarAdvectionStep(float dt);
+};
+
+// Preprocessor close statement
+#endif
@@ -0,0 +1,93 @@
+/* Header file for SIMD lane values, one simulation per lane */
+
+// Preprocessor statements
+#ifndef LANES_H
+#define LANES_H
+
+// Include statements
+#include <cmath>
+
+// K values of type E side by side, with elementwise arithmetic written as fixed-length
+// loops the compiler turns into vector instructions, so code written for one value
+// steps K independent values at once
+template<typename E, int K>
+struct Lanes
+{
+    E v[K];
+
+    // Constructors, broadcasting a single value or converting lane type
+    Lanes() = default;
+    Lanes(E value) { for(int k = 0; k < K; k++) { v[k] = value; } }
+    template<typename F> explicit Lanes(const Lanes<F, K> & other) { for(int k = 0; k < K; k++) { v[k] = other.v[k]; } }
+
+    // Elementwise arithmetic
+    friend Lanes operator+(Lanes a, const Lanes & b) { for(int k = 0; k < K; k++) { a.v[k] += b.v[k]; } return a; }
+    friend Lanes operator-(Lanes a, const Lanes & b) { for(int k = 0; k < K; k++) { a.v[k] -= b.v[k]; } return a; }
+    friend Lanes operator*(Lanes a, const Lanes & b) { for(int k = 0; k < K; k++) { a.v[k] *= b.v[k]; } return a; }
+    friend Lanes operator/(Lanes a, const Lanes & b) { for(int k = 0; k < K; k++) { a.v[k] /= b.v[k]; } return a; }
+    Lanes & operator+=(const Lanes & b) { return *this = *this + b; }
+    Lanes & operator-=(const Lanes & b) { return *this = *this - b; }
+
+    // Elementwise comparisons
+    friend Lanes<bool, K> operator==(const Lanes & a, const Lanes & b) { Lanes<bool, K> m; for(int k = 0; k < K; k++) { m.v[k] = a.v[k] == b.v[k]; } return m; }
+    friend Lanes<bool, K> operator!=(const Lanes & a, const Lanes & b) { Lanes<bool, K> m; for(int k = 0; k < K; k++) { m.v[k] = a.v[k] != b.v[k]; } return m; }
+    friend Lanes<bool, K> operator>(const Lanes & a, const Lanes & b) { Lanes<bool, K> m; for(int k = 0; k < K; k++) { m.v[k] = a.v[k] > b.v[k]; } return m; }
+
+    // Elementwise functions
+    friend Lanes max(Lanes a, const Lanes & b) { for(int k = 0; k < K; k++) { a.v[k] = a.v[k] > b.v[k] ? a.v[k] : b.v[k]; } return a; }
+    friend Lanes sqrt(Lanes a) { for(int k = 0; k < K; k++) { a.v[k] = std::sqrt(a.v[k]); } return a; }
+
+    // Lanes chosen from a where mask is set, else from b
+    friend Lanes Where(const Lanes<bool, K> & mask, Lanes a, const Lanes & b) { for(int k = 0; k < K; k++) { a.v[k] = mask.v[k] ? a.v[k] : b.v[k]; } return a; }
+
+    // Largest magnitude over lanes
+    friend float MaxAbs(const Lanes & a)
+    {
+        float m = 0;
+        for(int k = 0; k < K; k++){
+            m = std::fabs(a.v[k]) > m ? std::fabs(a.v[k]) : m;
+        }
+        return m;
+    }
+
+    // Sum of squares over lanes
+    friend double SumSquares(const Lanes & a)
+    {
+        double sum = 0;
+        for(int k = 0; k < K; k++){
+            sum += a.v[k] * a.v[k];
+        }
+        return sum;
+    }
+};
+
+// Whether any or all lanes of a comparison are set
+template<int K> inline bool Any(const Lanes<bool, K> & mask)
+{
+    for(int k = 0; k < K; k++){
+        if(mask.v[k]) { return true; }
+    }
+    return false;
+}
+
+template<int K> inline bool All(const Lanes<bool, K> & mask)
+{
+    for(int k = 0; k < K; k++){
+        if(!mask.v[k]) { return false; }
+    }
+    return true;
+}
+
+// Single values act as one lane
+inline bool Any(bool mask) { return mask; }
+inline bool All(bool mask) { return mask; }
+template<typename T> inline T Where(bool mask, T a, T b) { return mask ? a : b; }
+template<typename T> inline double SumSquares(T a) { return a * a; }
+template<typename T> inline float MaxAbs(T a) { return std::fabs(a); }
+
+// Set one lane of a value, or the value itself if it has no lanes
+inline void SetLane(float & x, int, float value) { x = value; }
+template<typename E, int K> inline void SetLane(Lanes<E, K> & x, int lane, E value) { x.v[lane] = value; }
+
+// Preprocessor close statement
+#endif
@@ -0,0 +1,63 @@
+/* Header file for geometric multigrid pressure solver */
+
+// Preprocessor statements
+#ifndef MULTIGRID_H
+#define MULTIGRID_H
+
+// Include statements
+#include <vector>
+#include "ThreadPool.h"
+
+// Cell-centered multigrid solver for the pressure Poisson equation
+class Multigrid
+{
+    public:
+
+        // Constructor and destructor
+        Multigrid(int Nx, int Ny, ThreadPool* threadPool);
+        ~Multigrid();
+
+        // Public methods
+        int Solve(float * p, float * div, int maxCycles, float tolerance, bool fullMultigrid);
+
+        // Public accessors
+        int GetNx();
+        int GetNy();
+        int GetLevels();
+        float LastResidual();
+
+    private:
+
+        // Grid and arrays at one level of the hierarchy
+        struct Level
+        {
+            int Nx;
+            int Ny;
+            float * x;
+            float * rhs;
+            float * res;
+        };
+
+        // Hierarchy, finest first
+        std::vector<Level> levels;
+
+        // Worker threads shared with simulation state
+        ThreadPool* threadPool;
+
+        // Relative residual at end of last solve, if measured
+        float lastResidual;
+
+        // Private methods
+        void VCycle(int level);
+        void Smooth(int level, int sweeps);
+        void ComputeResidual(int level);
+        void Restrict(int fineLevel, float * fine, float * coarse);
+        void Prolong(int coarseLevel, float * coarse, float * fine, bool addToFine);
+        void RemoveMean(int level, float * x);
+        double Norm(int level, float * x);
+        void Clear(int level, float * x);
+        int CoarseSweeps();
+};
+
+// Preprocessor close statement
+#endif
@@ -0,0 +1,120 @@
+/* Header file for reduced precision storage types */
+
+// Preprocessor statements
+#ifndef PRECISION_H
+#define PRECISION_H
+
+// Include statements
+#include <cstdint>
+#include <cstring>
+
+// Hardware half conversions when the build targets them
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+// IEEE half precision value, stored in 16 bits and converted to float for arithmetic
+struct Half
+{
+    uint16_t bits;
+
+    // Conversions, rounding to nearest even
+    Half() = default;
+    Half(float value) : bits(FromFloat(value)) {}
+    operator float() const { return ToFloat(bits); }
+
+    // Convert float to half precision bits, saturating to infinity
+    static uint16_t FromFloat(float value)
+    {
+#ifdef __F16C__
+        return _cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT);
+#endif
+        uint32_t f;
+        memcpy(&f, &value, sizeof(f));
+        uint32_t sign = f & 0x80000000u;
+        f ^= sign;
+
+        uint32_t h;
+        if(f >= 0x47800000u){
+
+            // Too large for half, or infinity or NaN
+            h = f > 0x7f800000u ? 0x7e00u : 0x7c00u;
+
+        }else if(f < 0x38800000u){
+
+            // Subnormal, rounded by adding in float
+            float shifted;
+            memcpy(&shifted, &f, sizeof(shifted));
+            shifted += 0.5f;
+            memcpy(&h, &shifted, sizeof(h));
+            h -= 0x3f000000u;
+
+        }else{
+
+            // Normal, rebiasing exponent and rounding mantissa
+            uint32_t odd = (f >> 13) & 1;
+            f += 0xc8000fffu + odd;
+            h = f >> 13;
+        }
+        return h | (sign >> 16);
+    }
+
+    // Convert half precision bits to float
+    static float ToFloat(uint16_t h)
+    {
+#ifdef __F16C__
+        return _cvtsh_ss(h);
+#endif
+        // Rescale exponent by multiplication, which also handles subnormals
+        uint32_t f = uint32_t(h & 0x7fffu) << 13;
+        float value;
+        memcpy(&value, &f, sizeof(value));
+        value *= 5.192296858534828e33f;
+
+        // Restore infinity and NaN
+        memcpy(&f, &value, sizeof(f));
+        if((h & 0x7c00u) == 0x7c00u){
+            f |= 0x7f800000u;
+        }
+        f |= uint32_t(h & 0x8000u) << 16;
+        memcpy(&value, &f, sizeof(value));
+        return value;
+    }
+};
+
+// Brain floating point value, the upper half of a float, with float's range and 8 bits of mantissa
+struct BFloat16
+{
+    uint16_t bits;
+
+    // Conversions, rounding to nearest even
+    BFloat16() = default;
+    BFloat16(float value) : bits(FromFloat(value)) {}
+    operator float() const { return ToFloat(bits); }
+
+    // Convert float to bfloat16 bits
+    static uint16_t FromFloat(float value)
+    {
+        uint32_t f;
+        memcpy(&f, &value, sizeof(f));
+
+        // Keep NaN quiet rather than rounding it to infinity
+        if((f & 0x7fffffffu) > 0x7f800000u){
+            return (f >> 16) | 0x40u;
+        }
+        f += 0x7fffu + ((f >> 16) & 1);
+        return f >> 16;
+    }
+
+    // Convert bfloat16 bits to float
+    static float ToFloat(uint16_t b)
+    {
+        uint32_t f = uint32_t(b) << 16;
+        float value;
+        memcpy(&value, &f, sizeof(value));
+        return value;
+    }
+};
+
+// Preprocessor close statement
+#endif
@@ -0,0 +1,52 @@
+/* Header file for ensembles of simulations stepped together */
+
+// Preprocessor statements
+#ifndef SIMENSEMBLE_H
+#define SIMENSEMBLE_H
+
+// Include statements
+#include <vector>
+#include "SimState.h"
+
+// K simulations on the same grid stepped in lockstep, one per SIMD lane. Each lane
+// is an ordinary SimState holding its own physical constants, sources, and fields,
+// so sources and loaders work on it unchanged; options, solvers, and scales are
+// shared and taken from the ensemble parameters
+template<int K>
+class SimEnsemble
+{
+    public:
+
+        // Constructors
+        SimEnsemble(int N, SimParams params);
+        SimEnsemble(int Nx, int Ny, SimParams params);
+        ~SimEnsemble();
+
+        // Public methods
+        void SimulationStep(float timeStep);
+        void ResetState();
+
+        // Lane accessors
+        SimState * Lane(int k);
+        int GetLanes();
+
+        // Grid size accessors
+        int GetNx();
+        int GetNy();
+
+        // Options, solvers, and scales shared by every lane
+        SimParams params;
+
+    private:
+
+        // Lanes stepped together, and each lane on its own
+        BasicSimState<Lanes<float, K>> * batch;
+        std::vector<SimState *> lanes;
+
+        // Private methods
+        void Interleave(Lanes<float, K> * x, float * SimState::Fields::* plane);
+        void Deinterleave(Lanes<float, K> * x, float * SimState::Fields::* plane);
+};
+
+// Preprocessor close statement
+#endif
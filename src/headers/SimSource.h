@@ -4,70 +4,22 @@
 #define SIMSOURCE_H
 
 // Include statements
+#include <functional>
 #include <list>
 #include <random>
 #include "SimState.h"
 
-// Structure which contains a density, velocity, or heat source for simulator
-class SimSource
+// Source shapes and types, and the sources themselves, shared by every field precision
+class SimSourceBase
 {
     public:
 
-        // Constructor
-        SimSource(SimState*);
-
         // Enumerable type designators
         enum Shape { square, circle, diamond, point };
         enum Type  { gas, wind, windBoundary, heat, energy };
 
-        // SimState object
-        SimState* simState;
-
-        // Public methods
-        void CreateGasSource(   Shape shape, float flowRate, float sourceTemp, 
-                                float xCenter, float yCenter, float radius);
-        void CreateGasSourceDynamic(    
-                                Shape shape, float flowRate, float sourceTemp, 
-                                float xCenter, float yCenter, float radius, 
-                                float flowVar, float tempVar);
-        void CreateWindSource(  float angle, float speed, 
-                                float xCenter, float yCenter);
-        void CreateWindSourceDynamic(   
-                                float angle, float speed, 
-                                float xCenter, float yCenter,
-                                float speedVar, float angleVar);
-        void CreateHeatSource(  Shape shape, float sourceTemp, 
-                                float xCenter, float yCenter, float radius);
-        void CreateHeatSourceDynamic(  
-                                Shape shape, float sourceTemp, 
-                                float xCenter, float yCenter, float radius,
-                                float tempVar);
-        void CreateEnergySource(Shape shape, float flux, float referenceTemp, float referenceDensity, 
-                                float xCenter, float yCenter, float radius);
-        void CreateEnergySourceDynamic(
-                                Shape shape, float flux, float referenceTemp, float referenceDensity, 
-                                float xCenter, float yCenter, float radius,
-                                float fluxVar);
-        void CreateWindBoundary(float speed );
-        void CreateWindBoundaryDynamic(
-                                float speed, float speedVar);
-
-        void RemoveSourceAtPoint(float x, float y, float dist);
-        void RemoveAllSources();
-
-        // Update sim object
-        void UpdateSources();
-        void UpdateSourcesDynamic();
-        void Reset();
-
     protected:
 
-        // Pointers to source grids
-        float * xVel;
-        float * yVel;
-        float * dens;
-        float * temp;
-
         // Sub-class for single source
         class Source
         {
@@ -105,45 +57,122 @@ class SimSource
                 float tVar = 0.0;
 
                 // Index calculation method
-                void SetIndices(int N, Shape shape, float xCenter, float yCenter, float radius);
+                void SetIndices(int Nx, int Ny, Shape shape, float xCenter, float yCenter, float radius);
         };
 
         class GasSource: public Source { 
             public:
-                GasSource(int N, float lengthScale, Shape shape, float flowRate, float sourceTemp, 
+                GasSource(int Nx, int Ny, float lengthScale, Shape shape, float flowRate, float sourceTemp, 
                         float xCenter, float yCenter, float radius);
                 float flowRate, sourceTemp; };
 
         class WindSource: public Source { 
             public:
-                WindSource(int N, float lengthScale, float angle, float speed, 
+                WindSource(int Nx, int Ny, float lengthScale, float angle, float speed, 
                         float xCenter, float yCenter);
                 float speed, direction; };
 
         class HeatSource: public Source { 
             public:
-                HeatSource(int N, float lengthScale, Shape shape, float sourceTemp, 
+                HeatSource(int Nx, int Ny, float lengthScale, Shape shape, float sourceTemp, 
                         float xCenter, float yCenter, float radius);
                 float sourceTemp; };
 
         class EnergySource: public Source { 
             public:
-                EnergySource(int N, float lengthScale, Shape shape, float flux, float referenceTemp, float referenceDensity,
+                EnergySource(int Nx, int Ny, float lengthScale, Shape shape, float flux, float referenceTemp, float referenceDensity,
                         float xCenter, float yCenter, float radius);
                 float flux, referenceTemp; };
 
         class WindBoundary: public Source {
             public:
-                WindBoundary(int N, float speed);
+                WindBoundary(int Nx, int Ny, float speed);
+                void SetBoundaryIndices(int Nx, int Ny);
                 float speed; };
+};
+
+// Structure which contains a density, velocity, or heat source for simulator
+template<typename Scalar>
+class BasicSimSource : public SimSourceBase
+{
+    public:
+
+        // Constructors, for sources of a SimState, or laid out on a grid of Nx by Ny
+        // cells for simulations holding their sources elsewhere
+        BasicSimSource(BasicSimState<Scalar>*);
+        BasicSimSource(int Nx, int Ny, float lengthScale);
+
+        // SimState object (null for sources laid out without one)
+        BasicSimState<Scalar>* simState;
+
+        // Public methods
+        void CreateGasSource(   Shape shape, float flowRate, float sourceTemp, 
+                                float xCenter, float yCenter, float radius);
+        void CreateGasSourceDynamic(    
+                                Shape shape, float flowRate, float sourceTemp, 
+                                float xCenter, float yCenter, float radius, 
+                                float flowVar, float tempVar);
+        void CreateWindSource(  float angle, float speed, 
+                                float xCenter, float yCenter);
+        void CreateWindSourceDynamic(   
+                                float angle, float speed, 
+                                float xCenter, float yCenter,
+                                float speedVar, float angleVar);
+        void CreateHeatSource(  Shape shape, float sourceTemp, 
+                                float xCenter, float yCenter, float radius);
+        void CreateHeatSourceDynamic(  
+                                Shape shape, float sourceTemp, 
+                                float xCenter, float yCenter, float radius,
+                                float tempVar);
+        void CreateEnergySource(Shape shape, float flux, float referenceTemp, float referenceDensity, 
+                                float xCenter, float yCenter, float radius);
+        void CreateEnergySourceDynamic(
+                                Shape shape, float flux, float referenceTemp, float referenceDensity, 
+                                float xCenter, float yCenter, float radius,
+                                float fluxVar);
+        void CreateWindBoundary(float speed );
+        void CreateWindBoundaryDynamic(
+                                float speed, float speedVar);
+
+        void RemoveSourceAtPoint(float x, float y, float dist);
+        void RemoveAllSources();
+
+        // Update sim object
+        void UpdateSources();
+        void UpdateSourcesDynamic();
+        void Reset();
+        void Resize();
+
+        // Apply sources with dynamic processes to cells (i, j) of another simulation
+        void ApplySources(const std::function<void(int i, int j, float xVel, float yVel, float dens, float temp)> & add);
+
+    protected:
+
+        // Pointers to source grids
+        float * xVel;
+        float * yVel;
+        Scalar * dens;
+        Scalar * temp;
 
         // List of sources
-        std::list<SimSource::Source*> sources;
+        std::list<Source*> sources;
+
+        // Grid of sources laid out without a SimState
+        int gridNx;
+        int gridNy;
+        float gridLengthScale;
 
         // Protected methods
         void RemoveSource(Source* source);
+        void ForSourceValues(bool dynamic, const std::function<void(int index, float xVel, float yVel, float dens, float temp)> & apply);
+        int GridNx();
+        int GridNy();
+        float GridLengthScale();
 };
 
+// Sources for a simulation stored in single precision
+typedef BasicSimSource<float> SimSource;
+
 // Helper method for normal distribution generation
 float RandomNormal(float mean, float dev);
 
@@ -5,6 +5,14 @@
 #define SIMSTATE_H
 
 #include <string>
+#include <functional>
+#include <future>
+#include <vector>
+#include "ThreadPool.h"
+#include "Multigrid.h"
+#include "ConjugateGradient.h"
+#include "Precision.h"
+#include "Lanes.h"
 
 // Structure to hold onto simulation properties and physical constants
 struct SimParams
@@ -30,12 +38,43 @@ struct SimParams
     std::string FloatName    (int paramNum, ParamType type);
     std::string FloatTip     (int paramNum, ParamType type);
 
+    // Solvers for linear systems (multigrid applies to pressure only)
+    enum SolverType { gaussSeidel, redBlack, multigrid, conjugateGradient };
+
+    // Advection schemes, the higher order ones correcting semi-Lagrangian error
+    enum AdvectionScheme { semiLagrangian, macCormack, bfecc };
+
     // Options
     bool closedBoundaries;
     bool advancedCoefficients;
     bool gravityOn;
     bool temperatureOn;
     int solverSteps;
+    SolverType diffusionSolver;
+    SolverType pressureSolver;
+    int numThreads;
+    int multigridCycles;
+    float solverTolerance;
+    int solverMaxIterations;
+    int residualCheckInterval;
+    bool warmStartPressure;
+    int tileSize;
+    int wavefrontSweeps;
+    bool hugePages;
+    bool adaptiveTimeStep;
+    float targetCFL;
+    int maxSubsteps;
+    AdvectionScheme velocityAdvection;
+    AdvectionScheme densityAdvection;
+    AdvectionScheme temperatureAdvection;
+    bool activeRegion;
+    float activeThreshold;
+    bool sparseGrid;
+    int amrLevels;
+    int amrPatchSize;
+    float amrDensity;
+    float amrGradient;
+    float amrVorticity;
 
     // Physical constants
     float lengthScale;
@@ -52,103 +91,355 @@ struct SimParams
     float tempDecay;
 };
 
-// Structure to hold onto array pointers
-struct SimFields
+// Types used with each field storage type: Real for velocity, pressure, and
+// coefficient planes and for arithmetic, Sum for reductions, and the number of
+// simulations stepped together
+template<typename Scalar>
+struct FieldTypes
 {
-    // Constructors
-    SimFields();
-    SimFields(int size);
+    typedef float Real;
+    typedef double Sum;
+    static constexpr int lanes = 1;
+};
+
+// Ensembles keep every plane in lanes, one simulation per lane
+template<int K>
+struct FieldTypes<Lanes<float, K>>
+{
+    typedef Lanes<float, K> Real;
+    typedef Lanes<double, K> Sum;
+    static constexpr int lanes = K;
+};
+
+// Physical constants in the form used on fields, one value per lane for ensembles
+template<typename Real>
+struct PhysicalConstants
+{
+    Real visc;
+    Real diff;
+    Real grav;
+    Real airDens;
+    Real massRatio;
+    Real airTemp;
+    Real diffTemp;
+    Real densDecay;
+    Real tempFactor;
+    Real tempDecay;
+
+    // Copy constants of one lane from parameters
+    void SetLane(int lane, const SimParams & params);
+
+    // Density of mixed fluid at air temperature, its temperature, and its density at
+    // that temperature, for a cell of fluid density dens at temperature temp
+    template<typename T> Real MixedDensityAtAirTemp(T dens) const
+    {
+        return airDens + dens * (1.0 - massRatio);
+    }
+    template<typename T> Real MixedTemperature(T dens, T temp) const
+    {
+        return airTemp + (temp - airTemp) * (dens / MixedDensityAtAirTemp(dens));
+    }
+    template<typename T> Real MixedDensity(T dens, T temp) const
+    {
+        return MixedDensityAtAirTemp(dens) * (airTemp / MixedTemperature(dens, temp));
+    }
+};
+
+// Structure to hold onto array pointers, with density and temperature stored as
+// Scalar (float, double, Half, or BFloat16) and everything else as Real
+template<typename Scalar>
+struct BasicSimFields
+{
+    // Type of velocity, pressure, and coefficient planes
+    typedef typename FieldTypes<Scalar>::Real Real;
+
+    // Constructors, owning one arena of field planes, so movable but not copyable
+    BasicSimFields();
+    BasicSimFields(int size, bool hugePages = false);
+    BasicSimFields(BasicSimFields && other);
+    BasicSimFields & operator=(BasicSimFields && other);
+    BasicSimFields(const BasicSimFields &) = delete;
+    BasicSimFields & operator=(const BasicSimFields &) = delete;
+    ~BasicSimFields();
 
-    // Public method
+    // Public methods
     void ClearFields();
+    void ZeroFields(int start, int end);
+
+    // Single allocation holding every plane, each starting on a cache line
+    char * arena;
 
     // Current grid
-    float * xVel;
-    float * yVel;
-    float * dens;
-    float * temp;
+    Real * xVel;
+    Real * yVel;
+    Scalar * dens;
+    Scalar * temp;
 
     // Previous grid
-    float * xVel_prev;
-    float * yVel_prev;
-    float * dens_prev;
-    float * temp_prev;
+    Real * xVel_prev;
+    Real * yVel_prev;
+    Scalar * dens_prev;
+    Scalar * temp_prev;
 
     // Source grid
-    float * xVel_source;
-    float * yVel_source;
-    float * dens_source;
-    float * temp_source;
+    Real * xVel_source;
+    Real * yVel_source;
+    Scalar * dens_source;
+    Scalar * temp_source;
+
+    // Pressure of each projection, kept between steps to seed the next one
+    Real * pres;
+    Real * pres_advect;
+
+    // Diffusion coefficients, evaluated once per step
+    Real * visc_coeff;
+    Real * diff_coeff;
+    Real * diffTemp_coeff;
+
+    // Mixed fluid density, at air temperature and at its own, and temperature, derived
+    // from density and temperature at most once between changes to them
+    Real * mixedDensAtAirTemp;
+    Real * mixedDens;
+    Real * mixedTemp;
+};
+
+// Fields stored in single precision throughout
+typedef BasicSimFields<float> SimFields;
+
+// Structure to hold convergence of the linear solves of one kind in a step
+struct SolveStats
+{
+    int iterations;
+    float residual;
+};
+
+// Box of interior cells [iStart, iEnd) by [jStart, jEnd)
+struct CellRegion
+{
+    int iStart;
+    int iEnd;
+    int jStart;
+    int jEnd;
 };
 
-// Class which defines and contains important simulation methods
-class SimState
+// Class which defines and contains important simulation methods, storing
+// density and temperature as Scalar while computing on them in float (or double)
+template<typename Scalar>
+class BasicSimState
 {
     public:
 
+        // Field storage of this state, and types for arithmetic on it
+        typedef BasicSimFields<Scalar> Fields;
+        typedef typename FieldTypes<Scalar>::Real Real;
+        typedef typename FieldTypes<Scalar>::Sum Sum;
+        typedef PhysicalConstants<Real> Constants;
+
         // Constructors
-        SimState();
-        SimState(int N);
-        SimState(int N, SimParams params);
+        BasicSimState(int N);
+        BasicSimState(int Nx, int Ny);
+        BasicSimState(int N, SimParams params);
+        BasicSimState(int Nx, int Ny, SimParams params);
+        ~BasicSimState();
+
+        // Linear solves tracked per step
+        enum SolveType { pressureSolve, xVelSolve, yVelSolve, densSolve, tempSolve, numSolves };
+
+        // Sides of the grid, as flags of those whose ghost cells are held
+        enum Side { leftSide = 1, rightSide = 2, bottomSide = 4, topSide = 8, allSides = 15 };
 
         // Public methods
-        void SetSources(float * density, float * xVelocity, float * yVelocity, float * temperature);
+        void SetSources(Scalar * density, Real * xVelocity, Real * yVelocity, Scalar * temperature);
         void SimulationStep(float timeStep);
         void SetBoundaryClosed(bool isClosed);
+        void SetBoundaryHeld(int sides);
         void ResetState();
         void ResetSources();
-        void ResizeGrid(int N);
+        void ResizeGrid(int Nx, int Ny);
+
+        // Live resize, allocating in the background and resampling fields on swap
+        void RequestResize(int Nx, int Ny);
+        bool FinishResize();
+
+        // Solver statistics from last step (residual is -1 when not measured)
+        SolveStats GetSolveStats(SolveType solve);
+
+        // Substeps taken in last step, and largest CFL number among them (-1 unless adaptive)
+        int GetSubsteps();
+        float GetCFL();
+
+        // Share of interior cells updated in last step (1 unless tracking active region)
+        float GetActiveFraction();
 
         // Array accessors
-        float * GetDensity();
-        float * GetXVelocity();
-        float * GetYVelocity();
-        float * GetTemperature();
+        Scalar * GetDensity();
+        Real * GetXVelocity();
+        Real * GetYVelocity();
+        Scalar * GetTemperature();
+
+        // Mixed fluid fields of current density and temperature, derived if out of date,
+        // and marking them out of date after writing density or temperature directly
+        Real * GetMixedDensity();
+        Real * GetMixedDensityAtAirTemp();
+        Real * GetMixedTemperature();
+        void InvalidateMixedFields();
 
         // Modified fields
-        static float MixedDensity(int ind, SimParams params, SimFields fields);
-        static float MixedDensityAtAirTemp(int ind, SimParams params, SimFields fields);
-        static float MixedTemperature(int ind, SimParams params, SimFields fields);
-        static float AdjustedMassDiffusivity(int ind, SimParams params, SimFields fields);
-        static float AdjustedViscosity(int ind, SimParams params, SimFields fields);
-        static float AdjustedThermalDiffusivity(int ind, SimParams params, SimFields fields);
+        static Real MixedDensity(int ind, const Constants & constants, const Fields & fields);
+        static Real MixedDensityAtAirTemp(int ind, const Constants & constants, const Fields & fields);
+        static Real MixedTemperature(int ind, const Constants & constants, const Fields & fields);
+        static Real AdjustedMassDiffusivity(int ind, bool advanced, const Constants & constants, const Fields & fields);
+        static Real AdjustedViscosity(int ind, bool advanced, const Constants & constants, const Fields & fields);
+        static Real AdjustedThermalDiffusivity(int ind, bool advanced, const Constants & constants, const Fields & fields);
 
         // Grid size accessors
-        int GetN();
+        int GetNx();
+        int GetNy();
         int GetSize();
 
+        // Boundary conditions for any grid
+        template<typename T> static void SetBoundary(int b, T * x, int Nx, int Ny);
+
+        // Boundary conditions refreshed by sweeps as they finish each row of region, then
+        // corners once sweeping is over, matching SetBoundary after every sweep
+        template<int b, typename T> static void SetRowBoundary(T * x, int Nx, int Ny, const CellRegion & region, int j);
+        template<typename T> static void SetCorners(T * x, int Nx, int Ny);
+
         // Parameter struct
         SimParams params;
 
+        // Parameters of each lane for ensembles, whose physical constants replace
+        // those of params (left empty for single simulations)
+        std::vector<SimParams> laneParams;
+
         // Array struct
-        SimFields fields;
+        Fields fields;
 
     private:
 
-        // Grid size
-        int N;
+        // Grid size, in interior cells across and up
+        int Nx;
+        int Ny;
         int size;
 
+        // Worker threads for parallel solvers
+        ThreadPool* threadPool;
+
+        // Pressure solver hierarchy, built on first use
+        Multigrid* multigrid;
+
+        // Conjugate gradient work arrays, built on first use
+        ConjugateGradient* conjugateGradient;
+
+        // Float copy of a field diffused by conjugate gradient, for other precisions
+        std::vector<float> solveScratch;
+
+        // Intermediate fields of higher order advection schemes
+        std::vector<Real> realAdvectScratch;
+        std::vector<Scalar> scalarAdvectScratch;
+
+        // Fields for requested grid size, allocated in the background
+        std::future<Fields> pendingFields;
+        int pendingNx;
+        int pendingNy;
+
+        // Solver statistics for current step
+        SolveStats solveStats[numSolves];
+
+        // Time step splitting of current step
+        int substeps;
+        float cfl;
+
+        // Cells updated outside the pressure solve this step, and whether they leave any out
+        CellRegion active;
+        bool activePartial;
+
+        // Physical constants of this step, from params or laneParams
+        Constants constants;
+
+        // Constants of constant coefficient fields, if filled
+        bool coefficientsConstant;
+        Constants coefficientConstants;
+
+        // Sides whose ghost cells keep the values the caller set before the step, with
+        // those of each field saved as the step starts
+        int heldSides;
+        std::vector<Scalar> heldDens;
+        std::vector<Scalar> heldTemp;
+        std::vector<Real> heldXVel;
+        std::vector<Real> heldYVel;
+        std::vector<Real> heldPres;
+        std::vector<Real> heldPresAdvect;
+
+        // Constants of mixed fluid fields, if derived from current density and temperature
+        bool mixedFieldsCurrent;
+        Constants mixedConstants;
+
         // Internal Methods
-        void SetSource(float *, float *);
-        void SetConstantSource(float *, float);
-        void AddSource(float *, float *, float);
-        void AddHeatSource(float *, float *);
-        void AddConstantSource(float *, float, float);
-
-        void Diffuse(int b, float * x, float * x0, float (*diff)(int, SimParams, SimFields), float dt);
-        void Dissipate(float *, float, float, float);
-        void DissipateWithFallOff(float *, float, float, float, float);
-        void Advect(int, float *, float *, float *, float *, float);
-        void Convect(float *, float);
-
-        void SetBoundary(int, float *);
-        void HodgeProjection(float *, float *, float *, float *);
-
-        void DensityStep(float);
-        void VelocityStep(float);
-        void TemperatureStep(float);
+        template<typename T> void SetSource(T *, T *);
+        template<typename T> void SetConstantSource(T *, Real);
+        template<typename T> void AddSource(T *, T *, float);
+        template<typename T> void AddHeatSource(T *, T *);
+        template<typename T> void AddConstantSource(T *, float, float);
+
+        template<int b, typename T> void Diffuse(T * x, T * x0, Real * coeff, float dt, SolveType solve);
+        template<typename T> void Dissipate(T *, Real, Real, float);
+        template<typename T> void DissipateWithFallOff(T *, Real, Real, Real, float);
+        template<typename T> void AdvectFields(T ** d, T ** d0, int count, Real * u, Real * v, float dt);
+        template<typename T> void AdvectFieldsByScheme(SimParams::AdvectionScheme scheme, T ** d, T ** d0, int count,
+                                                       const int * b, Real * u, Real * v, float dt);
+        template<typename T> void ClampAdvected(T ** d, T ** d0, int count, Real * u, Real * v, float dt);
+        template<bool temperature> void Convect(Real *, float);
+
+        template<typename T> void SetBoundary(int, T *);
+        template<int b, typename T> static void SetBoundary(T * x, int Nx, int Ny);
+        void HoldBoundaries();
+        template<typename T> std::vector<T> * HeldGhosts(T * x);
+        template<typename T> void CopyGhosts(T * x, T * ghosts, bool store);
+        void HodgeProjection(Real *, Real *, Real *, Real *);
+        void RelaxPressure(Real * p, Real * div);
+
+        template<int b, typename T> void DiffuseRedBlack(T * x, T * x0, Real * coeff, float a, int color);
+        void ProjectRedBlack(Real * p, Real * div, int color);
+        void UpdateThreadPool();
+        void UpdateConjugateGradient();
+
+        template<typename T> float DiffusionResidual(T * x, T * x0, Real * coeff, float a, double rhsNorm);
+        float PressureResidual(Real * p, Real * div, double rhsNorm);
+        template<typename V> V RowSum(const std::function<V(int)> & rowValue);
+        float MaxSpeed();
+        template<int b, typename T, typename CellUpdate> void SweepTiles(T * x, const CellRegion & region, const CellUpdate & update);
+        template<int b, typename T, typename CellUpdate> void SweepWavefront(T * x, const CellRegion & region, int sweeps, const CellUpdate & update);
+        int SweepsPerPass(int k, SimParams::SolverType solver);
+        void ClearSolveStats();
+        template<bool advanced> void UpdateCoefficients();
+        template<bool advanced> void UpdateThermalCoefficients();
+        void UpdateMixedFields();
+        void RemoveMean(Real * x);
+        void UpdateConstants();
+        template<typename T> void Resample(T * x, int Nx, int Ny, T * x0, int Nx0, int Ny0);
+        void RecordSolve(SolveType solve, int iterations, float residual);
+
+        // Step pipeline specialized on option flags, selected once per step
+        void DispatchStep(float);
+        void UpdateActiveRegion(float dt);
+        template<typename CellUpdate> void ForActiveCells(const CellUpdate & update);
+        template<typename T> void CopyOutsideRegion(T * x, T * x0);
+        template<bool closed, bool gravity, bool temperature, bool advanced> void StepVariant(float);
+        template<bool closed> void DensityStep(float);
+        template<bool closed, bool gravity, bool temperature> void VelocityStep(float);
+        template<bool advanced> void TemperatureStep(float);
+        template<bool closed, bool temperature> void ScalarAdvectionStep(float);
+
+        // Coefficients with temperature adjustment fixed at compile time, viscosity taking
+        // mixed fluid fields as derived for the step
+        template<bool advanced> static Real AdjustedMassDiffusivity(int ind, const Constants & constants, const Fields & fields);
+        template<bool advanced> static Real AdjustedViscosity(int ind, const Constants & constants, const Fields & fields);
+        template<bool advanced> static Real AdjustedThermalDiffusivity(int ind, const Constants & constants, const Fields & fields);
 };
 
+// Simulation stored in single precision throughout
+typedef BasicSimState<float> SimState;
+
 // Preprocessor close statement
 #endif
\ No newline at end of file
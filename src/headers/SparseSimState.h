@@ -0,0 +1,122 @@
+/* Header file for simulations on sparse brick grids */
+
+// Preprocessor statements
+#ifndef SPARSESIMSTATE_H
+#define SPARSESIMSTATE_H
+
+// Include statements
+#include <functional>
+#include <vector>
+#include "BrickGrid.h"
+#include "SimSource.h"
+#include "SimState.h"
+#include "ThreadPool.h"
+
+// Simulation on a grid stored in bricks, for very large domains that smoke fills only
+// in part. Bricks are kept where any field departs from rest or a source is set, plus
+// those flow can reach within a step, and every step works on those bricks alone, so
+// memory and time follow the occupied area. Beyond the bricks lies air at rest, and
+// walls are closed or open as in SimState. Whatever solver and advection the scene
+// asks for, diffusion and pressure relax by red-black sweeps, advection takes
+// semi-Lagrangian steps, and coefficients are constant
+class SparseSimState
+{
+    public:
+
+        // Constructors
+        SparseSimState(int N, SimParams params);
+        SparseSimState(int Nx, int Ny, SimParams params);
+        ~SparseSimState();
+
+        // Public methods
+        void SimulationStep(float timeStep);
+        void SetSource(int i, int j, float density, float temperature, float xVelocity, float yVelocity);
+        void SetSources(SimSource * source);
+        void ClearSources();
+        void ResetState();
+
+        // Cell accessors
+        float GetDensity(int i, int j);
+        float GetXVelocity(int i, int j);
+        float GetYVelocity(int i, int j);
+        float GetTemperature(int i, int j);
+
+        // Grid size accessors
+        int GetNx();
+        int GetNy();
+
+        // Density summed over the grid
+        float GetTotalDensity();
+
+        // Bricks allocated, and bytes they and the brick table hold
+        int GetActiveBricks();
+        size_t GetMemory();
+
+        // Simulation parameters; activeThreshold sets when a brick is at rest
+        SimParams params;
+
+    private:
+
+        // Planes held by each brick
+        enum Plane { xVelPlane, yVelPlane, densPlane, tempPlane,
+                     xVelPrevPlane, yVelPrevPlane, densPrevPlane, tempPrevPlane,
+                     xVelSourcePlane, yVelSourcePlane, densSourcePlane, tempSourcePlane,
+                     presPlane, presAdvectPlane, divPlane, numPlanes };
+
+        // Bricks of every field
+        BrickGrid * grid;
+
+        // Planes holding current and previous fields, swapped between steps
+        int xVel;
+        int yVel;
+        int dens;
+        int temp;
+        int xVel_prev;
+        int yVel_prev;
+        int dens_prev;
+        int temp_prev;
+
+        // Copies of every brick of a plane with its halo, and bricks to keep this step
+        std::vector<float> halos;
+        std::vector<char> keep;
+
+        // Worker threads, splitting the bricks
+        ThreadPool * threadPool;
+
+        // Physical constants of this step
+        PhysicalConstants<float> constants;
+
+        // Allocated brick being updated: its position in the list of bricks, its slot,
+        // its first cell less one, and how many of its cells lie in the grid
+        struct Brick
+        {
+            int k;
+            int slot;
+            int i0;
+            int j0;
+            int iCount;
+            int jCount;
+        };
+
+        // Private methods
+        void UpdateWalls();
+        void UpdateBricks(float dt);
+        void ForBricks(const std::function<void(const Brick & brick)> & update);
+        void GatherHalos(int plane);
+        void AddSource(int x, int s, float dt);
+        void AddHeatSource(int t, int s);
+        void Dissipate(int x, float eqVal, float rate, float fallOff, float dt);
+        void Convect(float dt);
+        void Diffuse(int x, int x0, float coeff, float dt);
+        void Project(int p);
+        void Advect(const int * d, const int * d0, int count, int u, int v, float dt);
+
+        // Collected steps
+        void VelocityStep(float dt);
+        void DensityStep(float dt);
+        void TemperatureStep(float dt);
+        void ScalarAdvectionStep(float dt);
+};
+
+// Preprocessor close statement
+#endif
@@ -9,7 +9,7 @@
 #include <string>
 #include "SimState.h"
 #include "SimSource.h"
-#include "Window.h"
+#include "WindowProps.h"
 
 // Global variables
 extern std::string projectPath;
@@ -17,22 +17,32 @@ extern std::string projectPath;
 //// Functions ////
 
 // Load state into existing objects
-void LoadState(const char* jsonFilename, SimState* state, SimSource* source);
+template<typename Scalar>
+void LoadState(const char* jsonFilename, BasicSimState<Scalar>* state, BasicSimSource<Scalar>* source);
 
 // Load state into existing objects (including params)
-void LoadState(const char* jsonFilename, SimState* state, SimParams* params, SimSource* source);
+template<typename Scalar>
+void LoadState(const char* jsonFilename, BasicSimState<Scalar>* state, SimParams* params, BasicSimSource<Scalar>* source);
 
 // Load only parameters
 void LoadParameters(const char* jsonFilename, SimParams* params);
 
 // Load only sources
-void LoadSources(const char* jsonFilename, SimSource* source);
+template<typename Scalar>
+void LoadSources(const char* jsonFilename, BasicSimSource<Scalar>* source);
 
 // Load parameters
 void LoadParams(nlohmann::json json, SimParams* params);
 
 // Load sources
-void LoadSources(nlohmann::json json, SimSource* source);
+template<typename Scalar>
+void LoadSources(nlohmann::json json, BasicSimSource<Scalar>* source);
+
+// Load grid resolution, either one size or [x, y] sizes
+void LoadResolution(nlohmann::json json, WindowProps* props);
+
+// Load grid resolution from window or record properties of file
+void LoadResolution(const char* jsonFilename, WindowProps* props);
 
 // Load window
 void LoadWindow(nlohmann::json json, WindowProps* props);
@@ -52,5 +62,11 @@ SimSource::Shape StringToShape(std::string shapeName);
 // Convert string to enum for type
 SimSource::Type StringToType(std::string typeName);
 
+// Convert string to enum for solver
+SimParams::SolverType StringToSolver(std::string solverName);
+
+// Convert string to enum for advection scheme
+SimParams::AdvectionScheme StringToAdvection(std::string schemeName);
+
 // Preprocessor end statement
 #endif
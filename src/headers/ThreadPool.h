@@ -0,0 +1,54 @@
+/* Header file for worker thread pool */
+
+// Preprocessor statements
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+// Include statements
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads for splitting grid loops across cores
+class ThreadPool
+{
+    public:
+
+        // Constructor and destructor
+        ThreadPool(int numThreads);
+        ~ThreadPool();
+
+        // Public methods
+        void ParallelFor(int begin, int end, const std::function<void(int, int)> & task);
+
+        // Public accessors
+        int NumThreads();
+
+    private:
+
+        // Private methods
+        void WorkerLoop(int worker);
+        void RunChunk(int chunk);
+
+        // Worker threads
+        int numThreads;
+        std::vector<std::thread> workers;
+
+        // Current task and its range
+        const std::function<void(int, int)> * task;
+        int begin;
+        int end;
+
+        // Synchronization
+        std::mutex mutex;
+        std::condition_variable startCondition;
+        std::condition_variable doneCondition;
+        unsigned int generation;
+        int remaining;
+        bool stopping;
+};
+
+// Preprocessor close statement
+#endif
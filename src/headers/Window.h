@@ -9,6 +9,7 @@
 #include "SimState.h"
 #include "SimTimer.h"
 #include "SimSource.h"
+#include "WindowProps.h"
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
@@ -16,17 +17,6 @@
 #include <imgui/imgui_impl_glfw.h>
 #include <imgui/imgui_impl_opengl3.h>
 
-// Struct to carry window properties
-struct WindowProps
-{
-    int resolution;
-    int winWidth;
-    int controlWidth;
-    int maxFrameRate;
-    float fps;
-    int numFrames;
-};
-
 // Struct to carry shader variables
 struct ShaderVars {
     float brightness = 1.0;
@@ -37,14 +27,16 @@ struct ShaderVars {
 
 /// Setup methods ///
 
-GLFWwindow* SimWindowSetup(int res, int windowWidth);
+GLFWwindow* SimWindowSetup(int xRes, int yRes, int windowWidth);
 void SetupTextures();
+void SetQuadVertices();
+void ResizeSimWindow(GLFWwindow* window, int xRes, int yRes);
 void DrawCursor(GLFWwindow* window);
 void ControlWindowSetup(GLFWwindow* window, int controlPanelWidth);
 
 /// Main loop render methods ///
 
-void SimWindowRenderLoop(GLFWwindow* window, float* density, float* temperature);
+void SimWindowRenderLoop(GLFWwindow* window, SimState* state);
 void ControlWindowRenderLoop(GLFWwindow* window, SimState* state, SimSource* source, SimTimer* timer, WindowProps* props);
 
 // GUI submethods
@@ -52,9 +44,10 @@ void ControlWindowRenderLoop(GLFWwindow* window, SimState* state, SimSource* sou
 void ParameterGUI(SimState* state);
 void ShaderGUI();
 void ResetGUI(SimState* state, SimSource* source);
-void WindowGUI(SimState* state, SimSource* source, WindowProps* props, SimTimer* timer);
+void WindowGUI(SimState* state, WindowProps* props, SimTimer* timer);
 void SourceGUI(GLFWwindow* window, SimState* state, SimSource* source);
 void FramerateGUI(SimTimer* timer);
+void SolverStatsGUI(SimState* state);
 
 /// Callbacks ///
 
@@ -0,0 +1,20 @@
+/* Header file for window properties, kept apart from OpenGL so loaders can use it headless */
+
+// Preprocessor statements
+#ifndef WINDOWPROPS_H
+#define WINDOWPROPS_H
+
+// Struct to carry window properties
+struct WindowProps
+{
+    int xResolution;
+    int yResolution;
+    int winWidth;
+    int controlWidth;
+    int maxFrameRate;
+    float fps;
+    int numFrames;
+};
+
+// Preprocessor close statement
+#endif
@@ -29,12 +29,16 @@ int main(int argc, char** argv){
     // Initialize state objects
     WindowProps props;
     LoadWindow("match", &props);
-    SimState state(props.resolution);
+    // Parameters are read before the state is built, so its fields are allocated and
+    // first touched with the threads and page size the scene asks for
+    SimParams params;
+    LoadParameters("match", &params);
+    SimState state(props.xResolution, props.yResolution, params);
     SimSource sources(&state);
     LoadState("match", &state, &sources);
 
     // Set up simulation and control windows
-    GLFWwindow* window = SimWindowSetup(props.resolution, props.winWidth);
+    GLFWwindow* window = SimWindowSetup(props.xResolution, props.yResolution, props.winWidth);
     ControlWindowSetup(window, props.controlWidth);
 
     // Initialize timers
@@ -48,8 +52,14 @@ int main(int argc, char** argv){
         // Declare beginning of frame
         timer.StartFrame();
 
+        // Swap in resized grid between steps once allocated
+        if(state.FinishResize()){
+            sources.Resize();
+            ResizeSimWindow(window, state.GetNx(), state.GetNy());
+        }
+
         // Draw current density to OpenGL window
-        SimWindowRenderLoop(window, state.fields.dens, state.fields.temp);
+        SimWindowRenderLoop(window, &state);
 
         // Draw control window
         ControlWindowRenderLoop(window, &state, &sources, &timer, &props);
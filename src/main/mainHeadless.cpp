@@ -0,0 +1,132 @@
+// Pre-processor include statements
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Project header files
+#include "../headers/AMRState.h"
+#include "../headers/SimSource.h"
+#include "../headers/SimState.h"
+#include "../headers/SparseSimState.h"
+#include "../headers/StateLoader.h"
+
+// Global variables
+std::string projectPath;
+
+// Run scene on a sparse brick grid, laying sources out on their own rather than on a
+// full grid, which is never allocated
+int RunSparse(const std::string & filename, const WindowProps & props, const SimParams & params, int numFrames, float fps){
+
+    // The sparse grid has one solver, advection scheme, and set of coefficients, whatever
+    // the scene asks for
+    if(params.diffusionSolver != SimParams::redBlack || params.pressureSolver != SimParams::redBlack ||
+       params.velocityAdvection != SimParams::semiLagrangian || params.densityAdvection != SimParams::semiLagrangian ||
+       params.temperatureAdvection != SimParams::semiLagrangian || params.advancedCoefficients){
+        std::cerr << "Sparse grid uses red-black solves, semi-Lagrangian advection, and constant coefficients" << std::endl;
+    }
+
+    // Initialize state objects
+    SparseSimState state(props.xResolution, props.yResolution, params);
+    SimSource sources(props.xResolution, props.yResolution, params.lengthScale);
+    LoadSources(filename.c_str(), &sources);
+
+    // Simulation loop, stepping as fast as possible
+    auto start = std::chrono::steady_clock::now();
+    for(int frame = 0; frame < numFrames; frame++){
+
+        // Update dynamic sources
+        state.SetSources(&sources);
+
+        // Update simulation state
+        state.SimulationStep(1.0 / fps);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Report timing, with the bricks the run ends on
+    std::cout << "Grid:           " << state.GetNx() << " x " << state.GetNy() << " (sparse)" << std::endl;
+    std::cout << "Frames:         " << numFrames << std::endl;
+    std::cout << "Total time:     " << seconds << " s" << std::endl;
+    std::cout << "Time per frame: " << 1000 * seconds / numFrames << " ms" << std::endl;
+    std::cout << "Frame rate:     " << numFrames / seconds << " fps" << std::endl;
+    std::cout << "Total density:  " << state.GetTotalDensity() << std::endl;
+    std::cout << "Bricks:         " << state.GetActiveBricks() << std::endl;
+    std::cout << "Memory:         " << state.GetMemory() / (1024.0 * 1024.0) << " MiB" << std::endl;
+
+    // Exit code
+    return 0;
+}
+
+int main(int argc, char** argv){
+
+    // Scene name and frame count as arguments, with optional frame rate
+    if(argc < 3){
+        std::cerr << "Usage: " << argv[0] << " <scene> <frames> [fps]" << std::endl;
+        return 1;
+    }
+    std::string filename = argv[1];
+    int numFrames = atoi(argv[2]);
+    float fps = argc > 3 ? atof(argv[3]) : 60.0;
+
+    // Get project path
+    std::string fullpath = argv[0];
+    projectPath = fullpath.substr(0, fullpath.find_last_of("/")) + "/..";
+
+    // Initialize state objects
+    WindowProps props;
+    LoadResolution(filename.c_str(), &props);
+    // Parameters are read before the state is built, so its fields are allocated and
+    // first touched with the threads and page size the scene asks for
+    SimParams params;
+    LoadParameters(filename.c_str(), &params);
+    if(params.sparseGrid){
+        return RunSparse(filename, props, params, numFrames, fps);
+    }
+    SimState state(props.xResolution, props.yResolution, params);
+    SimSource sources(&state);
+    LoadState(filename.c_str(), &state, &sources);
+
+    // Refined patches over the grid, if requested
+    AMRState * amr = state.params.amrLevels > 0 ? new AMRState(&state) : nullptr;
+
+    // Simulation loop, stepping as fast as possible
+    auto start = std::chrono::steady_clock::now();
+    for(int frame = 0; frame < numFrames; frame++){
+
+        // Update dynamic sources
+        sources.UpdateSourcesDynamic();
+
+        // Update simulation state, with its patches if refined
+        if(amr){
+            amr -> SimulationStep(1.0 / fps);
+        }else{
+            state.SimulationStep(1.0 / fps);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Total density as a check that runs agree
+    double totalDensity = 0;
+    for(int i = 0; i < state.GetSize(); i++){
+        totalDensity += state.fields.dens[i];
+    }
+
+    // Report timing
+    std::cout << "Grid:           " << state.GetNx() << " x " << state.GetNy() << std::endl;
+    std::cout << "Frames:         " << numFrames << std::endl;
+    std::cout << "Total time:     " << seconds << " s" << std::endl;
+    std::cout << "Time per frame: " << 1000 * seconds / numFrames << " ms" << std::endl;
+    std::cout << "Frame rate:     " << numFrames / seconds << " fps" << std::endl;
+    std::cout << "Total density:  " << totalDensity << std::endl;
+    if(amr){
+        std::cout << "Patches:       ";
+        for(int level = 1; level <= amr -> GetLevels(); level++){
+            std::cout << " " << amr -> GetPatches(level);
+        }
+        std::cout << std::endl;
+        delete amr;
+    }
+
+    // Exit code
+    return 0;
+}
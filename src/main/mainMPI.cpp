@@ -0,0 +1,89 @@
+// Pre-processor include statements
+#include <mpi.h>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Project header files
+#include "../headers/DistributedSimState.h"
+#include "../headers/SimSource.h"
+#include "../headers/SimState.h"
+#include "../headers/StateLoader.h"
+
+// Global variables
+std::string projectPath;
+
+int main(int argc, char** argv){
+
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Scene name and frame count as arguments, with optional frame rate
+    if(argc < 3){
+        if(rank == 0){
+            std::cerr << "Usage: mpirun -np <processes> " << argv[0] << " <scene> <frames> [fps]" << std::endl;
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    std::string filename = argv[1];
+    int numFrames = atoi(argv[2]);
+    float fps = argc > 3 ? atof(argv[3]) : 60.0;
+
+    // Get project path
+    std::string fullpath = argv[0];
+    projectPath = fullpath.substr(0, fullpath.find_last_of("/")) + "/..";
+
+    // Every process reads the parameters and sources, laying sources out on its own rows
+    WindowProps props;
+    LoadResolution(filename.c_str(), &props);
+    SimParams params;
+    LoadParameters(filename.c_str(), &params);
+    SimSource sources(props.xResolution, props.yResolution, params.lengthScale);
+    LoadSources(filename.c_str(), &sources);
+    DistributedSimState state(props.xResolution, props.yResolution, params);
+
+    // Slabs have one solver and advection scheme, and update every cell, whatever the
+    // scene asks for
+    if(rank == 0 && (params.diffusionSolver != SimParams::redBlack || params.pressureSolver != SimParams::redBlack ||
+                     params.velocityAdvection != SimParams::semiLagrangian || params.densityAdvection != SimParams::semiLagrangian ||
+                     params.temperatureAdvection != SimParams::semiLagrangian || params.activeRegion)){
+        std::cerr << "Distributed grid uses red-black solves and semi-Lagrangian advection over every cell" << std::endl;
+    }
+
+    // Simulation loop, stepping as fast as possible
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+    int substeps = 0;
+    for(int frame = 0; frame < numFrames; frame++){
+
+        // Update dynamic sources
+        state.SetSources(&sources);
+
+        // Update simulation state
+        state.SimulationStep(1.0 / fps);
+        substeps += state.GetSubsteps();
+    }
+    double seconds = MPI_Wtime() - start;
+
+    // Total density as a check that runs agree, whatever the number of processes
+    double totalDensity = state.TotalDensity();
+
+    // Report timing
+    if(rank == 0){
+        std::cout << "Grid:           " << state.GetNx() << " x " << state.GetNy() << std::endl;
+        std::cout << "Processes:      " << state.GetRanks() << std::endl;
+        std::cout << "Frames:         " << numFrames << std::endl;
+        std::cout << "Substeps:       " << substeps << std::endl;
+        std::cout << "Total time:     " << seconds << " s" << std::endl;
+        std::cout << "Time per frame: " << 1000 * seconds / numFrames << " ms" << std::endl;
+        std::cout << "Frame rate:     " << numFrames / seconds << " fps" << std::endl;
+        std::cout.precision(17);
+        std::cout << "Total density:  " << totalDensity << std::endl;
+    }
+
+    // Exit code
+    MPI_Finalize();
+    return 0;
+}
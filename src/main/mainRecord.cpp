@@ -37,12 +37,17 @@ int main(int argc, char** argv){
     WindowProps props;
     LoadRecord("record", &props);
     int winWidth = props.winWidth;
-    SimState state(props.resolution);
+    int winHeight = int(round(winWidth * float(props.yResolution) / props.xResolution));
+    // Parameters are read before the state is built, so its fields are allocated and
+    // first touched with the threads and page size the scene asks for
+    SimParams params;
+    LoadParameters("record", &params);
+    SimState state(props.xResolution, props.yResolution, params);
     SimSource sources(&state);
     LoadState("record", &state, &sources);
 
     // Set up simulation and control windows
-    GLFWwindow* window = SimWindowSetup(props.resolution, props.winWidth);
+    GLFWwindow* window = SimWindowSetup(props.xResolution, props.yResolution, props.winWidth);
 
     // Initialize timers
     SimTimer timer(props.fps);
@@ -50,9 +55,9 @@ int main(int argc, char** argv){
 
     // Create array for image data
     BMP output;
-    output.SetSize(winWidth, winWidth);
+    output.SetSize(winWidth, winHeight);
     output.SetBitDepth(24);
-    unsigned char* imageData = (unsigned char *)malloc(sizeof(unsigned char) * (winWidth*winWidth*3));
+    unsigned char* imageData = (unsigned char *)malloc(sizeof(unsigned char) * (winWidth*winHeight*3));
 
     // Simulation loop
     while(!glfwWindowShouldClose(window))
@@ -61,7 +66,7 @@ int main(int argc, char** argv){
         timer.StartFrame();
 
         // Draw current density to OpenGL window
-        SimWindowRenderLoop(window, state.fields.dens, state.fields.temp);
+        SimWindowRenderLoop(window, &state);
         glfwSwapBuffers(window);
 
         // Update dynamic sources
@@ -71,8 +76,8 @@ int main(int argc, char** argv){
         state.SimulationStep(1.0 / float(props.fps));
 
         // Save openGl data to images
-        glReadPixels(0, 0, winWidth, winWidth, GL_RGB, GL_UNSIGNED_BYTE, imageData);
-        for(int i = 0; i < winWidth; i++){
+        glReadPixels(0, 0, winWidth, winHeight, GL_RGB, GL_UNSIGNED_BYTE, imageData);
+        for(int i = 0; i < winHeight; i++){
             for(int j = 0; j < winWidth; j++){
 
                 int ind = 3 * ((i * winWidth) + j);
@@ -82,7 +87,7 @@ int main(int argc, char** argv){
                 pixelColor.Blue     = imageData[ind+2];
                 
 
-                *output(j, winWidth - (i + 1)) = pixelColor;
+                *output(j, winHeight - (i + 1)) = pixelColor;
             }
         }
         std::string savePath = projectPath + "/output/bmp/" + filename + "_" + std::to_string(timer.CurrentFrame()) + ".bmp";
@@ -0,0 +1,693 @@
+/* Function definition file for simulations split across MPI processes */
+
+// Include header definitions
+#include "../headers/DistributedSimState.h"
+
+// Includes and usings
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+using namespace std;
+
+// Macros
+#define ind(i,j) ((i) + (Nx + 2)*(j))
+
+// Planes held by each process
+static const int numPlanes = 18;
+
+
+
+//// PUBLIC METHODS ////
+
+// Constructor taking param struct, for square grid
+DistributedSimState::DistributedSimState(int N, SimParams params, MPI_Comm comm) : DistributedSimState(N, N, params, comm)
+{
+}
+
+// Constructor taking param struct, for grid of Nx by Ny cells split into slabs of rows
+DistributedSimState::DistributedSimState(int Nx, int Ny, SimParams params, MPI_Comm comm)
+{
+    this -> params = params;
+    this -> comm = comm;
+    this -> Nx = Nx;
+    this -> Ny = Ny;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &ranks);
+    if(Ny < ranks){
+        throw invalid_argument("DistributedSimState: fewer grid rows than processes");
+    }
+
+    // Split rows as evenly as possible, lower processes taking lower rows
+    rowCounts.resize(ranks);
+    rowOffsets.resize(ranks);
+    for(int r = 0, offset = 0; r < ranks; r++){
+        rowCounts[r] = Ny / ranks + (r < Ny % ranks);
+        rowOffsets[r] = offset;
+        offset += rowCounts[r];
+    }
+    rows = rowCounts[rank];
+    rowStart = rowOffsets[rank] + 1;
+    below = rank > 0 ? rank - 1 : MPI_PROC_NULL;
+    above = rank < ranks - 1 ? rank + 1 : MPI_PROC_NULL;
+
+    // Rows held here with a ghost row either side
+    size = (Nx + 2) * (rows + 2);
+    planes.resize(numPlanes * size);
+    float ** plane[numPlanes] = { &xVel, &yVel, &dens, &temp,
+                                  &xVel_prev, &yVel_prev, &dens_prev, &temp_prev,
+                                  &xVel_source, &yVel_source, &dens_source, &temp_source,
+                                  &pres, &pres_advect, &div,
+                                  &visc_coeff, &diff_coeff, &diffTemp_coeff };
+    for(int k = 0; k < numPlanes; k++){
+        *plane[k] = planes.data() + k * size;
+    }
+
+    substeps = 0;
+    cfl = -1;
+    ResetState();
+}
+
+// Destructor
+DistributedSimState::~DistributedSimState()
+{
+}
+
+// Run simulation step, split so flow crosses at most one cell per substep
+void DistributedSimState::SimulationStep(float timeStep)
+{
+    // Adjust for time scale
+    float dt = timeStep * params.timeScale;
+
+    // Take physical constants for this step
+    constants.SetLane(0, params);
+
+    // Split remaining time into the fewest substeps keeping the CFL number under target,
+    // which halos of one row cap at one, measuring velocity again before each substep
+    // as in SimState; past maxSubsteps, departure points are held to the next row
+    float target = params.adaptiveTimeStep ? min(max(params.targetCFL, 0.01f), 1.0f) : 1.0f;
+    float cellSize = params.lengthScale / Nx;
+    float remaining = dt;
+    substeps = 0;
+    cfl = -1;
+    while(true){
+        float remainingCFL = MaxSpeed() * remaining / cellSize;
+        float limit = max(1, params.maxSubsteps - substeps);
+        int count = (int)min(max(1.0f, ceil(remainingCFL / target)), limit);
+
+        // Take one substep of the even split
+        float h = remaining / count;
+        cfl = max(cfl, remainingCFL / count);
+        DispatchStep(h);
+        substeps++;
+        if(count == 1){
+            break;
+        }
+        remaining -= h;
+    }
+}
+
+// Lay sources out on the rows held here, with their ghost rows, summing rates and
+// taking the hottest temperature where sources overlap as SimSource does on a full
+// grid. Every process keeps its own source, laid out on the global grid, so none holds
+// the whole grid and nothing is sent; dynamic sources draw their values on each process
+void DistributedSimState::SetSources(SimSource * source)
+{
+    std::fill(xVel_source, xVel_source + size, 0.0f);
+    std::fill(yVel_source, yVel_source + size, 0.0f);
+    std::fill(dens_source, dens_source + size, 0.0f);
+    std::fill(temp_source, temp_source + size, constants.airTemp);
+
+    source -> ApplySources([&](int i, int j, float xVelocity, float yVelocity, float density, float temperature){
+        int localRow = j - rowStart + 1;
+        if(localRow < 0 || localRow > rows + 1){
+            return;
+        }
+        int c = ind(i, localRow);
+        xVel_source[c] += xVelocity;
+        yVel_source[c] += yVelocity;
+        dens_source[c] = dens_source[c] + density;
+        temp_source[c] = max(temp_source[c], temperature);
+    });
+}
+
+// Collect density of every process into the grid on root, with ghost cells left as they were
+void DistributedSimState::GatherDensity(float * density, int root)
+{
+    std::vector<int> counts(ranks), offsets(ranks);
+    for(int r = 0; r < ranks; r++){
+        counts[r] = rowCounts[r] * (Nx + 2);
+        offsets[r] = (rowOffsets[r] + 1) * (Nx + 2);
+    }
+    MPI_Gatherv(dens + ind(0,1), rows * (Nx + 2), MPI_FLOAT,
+                density, counts.data(), offsets.data(), MPI_FLOAT, root, comm);
+}
+
+// Reset to air at rest at air temperature, with no sources
+void DistributedSimState::ResetState()
+{
+    constants.SetLane(0, params);
+    std::fill(planes.begin(), planes.end(), 0.0f);
+    std::fill(temp, temp + size, constants.airTemp);
+    std::fill(temp_prev, temp_prev + size, constants.airTemp);
+    std::fill(temp_source, temp_source + size, constants.airTemp);
+}
+
+// Density summed over interior cells of the whole grid
+double DistributedSimState::TotalDensity()
+{
+    return RowSum([&](int j){
+        double sum = 0;
+        for(int i = 1; i <= Nx; i++){
+            sum += dens[ind(i,j)];
+        }
+        return sum;
+    });
+}
+
+// Grid size accessors
+int DistributedSimState::GetNx() { return Nx; }
+int DistributedSimState::GetNy() { return Ny; }
+
+// Process accessors
+int DistributedSimState::GetRank() { return rank; }
+int DistributedSimState::GetRanks() { return ranks; }
+int DistributedSimState::GetRowStart() { return rowStart; }
+int DistributedSimState::GetRows() { return rows; }
+
+// Step statistics
+int DistributedSimState::GetSubsteps() { return substeps; }
+float DistributedSimState::GetCFL() { return cfl; }
+
+
+//// PRIVATE METHODS ////
+
+// Post exchange of the edge rows of x for the ghost rows of the processes below and
+// above; rows are sent whole, ghost columns included
+void DistributedSimState::StartExchange(float * x)
+{
+    int n = requests.size();
+    requests.resize(n + 4);
+    MPI_Irecv(x + ind(0,0),        Nx + 2, MPI_FLOAT, below, 0, comm, &requests[n]);
+    MPI_Irecv(x + ind(0,rows + 1), Nx + 2, MPI_FLOAT, above, 1, comm, &requests[n + 1]);
+    MPI_Isend(x + ind(0,1),        Nx + 2, MPI_FLOAT, below, 1, comm, &requests[n + 2]);
+    MPI_Isend(x + ind(0,rows),     Nx + 2, MPI_FLOAT, above, 0, comm, &requests[n + 3]);
+}
+
+// Wait for every exchange posted
+void DistributedSimState::FinishExchange()
+{
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    requests.clear();
+}
+
+// Evaluate boundary conditions at walls, as SetBoundary in SimState, leaving halo rows
+template<int b>
+void DistributedSimState::SetWalls(float * x)
+{
+    // Reflection factors across vertical and horizontal walls
+    const float xMod = b == -1 ? 0. : (b == 1 ? -1. : 1.);
+    const float yMod = b == -1 ? 0. : (b == 2 ? -1. : 1.);
+
+    // Side walls, also of halo rows, where they match those of the process holding the row
+    int jStart = below == MPI_PROC_NULL ? 1 : 0;
+    int jEnd = above == MPI_PROC_NULL ? rows : rows + 1;
+    for(int j = jStart; j <= jEnd; j++){
+        x[ind(0,   j)] = xMod * x[ind(1, j)];
+        x[ind(Nx+1,j)] = xMod * x[ind(Nx,j)];
+    }
+
+    // Bottom and top walls, with their corners
+    if(below == MPI_PROC_NULL){
+        for(int i = 1; i <= Nx; i++){
+            x[ind(i,0)] = yMod * x[ind(i,1)];
+        }
+        x[ind(0,   0)] = 0.5 * (x[ind(1, 0)] + x[ind(0,   1)]);
+        x[ind(Nx+1,0)] = 0.5 * (x[ind(Nx,0)] + x[ind(Nx+1,1)]);
+    }
+    if(above == MPI_PROC_NULL){
+        for(int i = 1; i <= Nx; i++){
+            x[ind(i,rows+1)] = yMod * x[ind(i,rows)];
+        }
+        x[ind(0,   rows+1)] = 0.5 * (x[ind(1, rows+1)] + x[ind(0,   rows)]);
+        x[ind(Nx+1,rows+1)] = 0.5 * (x[ind(Nx,rows+1)] + x[ind(Nx+1,rows)]);
+    }
+}
+
+// Exchange halo rows, then evaluate boundary conditions at walls
+template<int b>
+void DistributedSimState::SetBoundary(float * x)
+{
+    StartExchange(x);
+    FinishExchange();
+    SetWalls<b>(x);
+}
+
+// Sum per-row values over interior rows of every process, gathering the rows so they
+// are added in order as in SimState, whatever the split
+double DistributedSimState::RowSum(const std::function<double(int)> & rowValue)
+{
+    std::vector<double> local(rows);
+    for(int j = 1; j <= rows; j++){
+        local[j - 1] = rowValue(j);
+    }
+
+    std::vector<double> sums(Ny);
+    MPI_Allgatherv(local.data(), rows, MPI_DOUBLE, sums.data(), rowCounts.data(), rowOffsets.data(), MPI_DOUBLE, comm);
+
+    double sum = 0;
+    for(int j = 0; j < Ny; j++){
+        sum += sums[j];
+    }
+    return sum;
+}
+
+// Largest velocity component over the whole grid
+float DistributedSimState::MaxSpeed()
+{
+    float speed = 0;
+    for(int j = 1; j <= rows; j++){
+        for(int i = 1; i <= Nx; i++){
+            speed = max(speed, max(MaxAbs(xVel[ind(i,j)]), MaxAbs(yVel[ind(i,j)])));
+        }
+    }
+
+    float globalSpeed;
+    MPI_Allreduce(&speed, &globalSpeed, 1, MPI_FLOAT, MPI_MAX, comm);
+    return globalSpeed;
+}
+
+// Update every row of the slab, the edge rows first so the halo exchange of planes x
+// runs while the inner rows are updated
+template<typename Update>
+void DistributedSimState::UpdateRows(float ** x, int count, const Update & update)
+{
+    update(1);
+    if(rows > 1){
+        update(rows);
+    }
+    for(int f = 0; f < count; f++){
+        StartExchange(x[f]);
+    }
+    for(int j = 2; j < rows; j++){
+        update(j);
+    }
+    FinishExchange();
+}
+
+// Relax cells of one checkerboard color of x, colored by global row as in SimState
+template<typename Relax>
+void DistributedSimState::Sweep(float * x, int color, const Relax & relax)
+{
+    UpdateRows(&x, 1, [&](int j){
+        for(int i = 1 + (rowStart - 1 + j + color + 1) % 2; i <= Nx; i += 2){
+            relax(i, j);
+        }
+    });
+}
+
+// Run one step
+void DistributedSimState::DispatchStep(float dt)
+{
+    UpdateCoefficients();
+    if(params.closedBoundaries){
+        VelocityStep<true>(dt);
+        DensityStep<true>(dt);
+    }else{
+        VelocityStep<false>(dt);
+        DensityStep<false>(dt);
+    }
+    if(params.temperatureOn){
+        TemperatureStep(dt);
+    }
+    if(params.closedBoundaries){
+        ScalarAdvectionStep<true>(dt);
+    }else{
+        ScalarAdvectionStep<false>(dt);
+    }
+}
+
+// Fill viscosity and mass diffusivity of every cell held here from density and
+// temperature as the step starts, adjusted as in SimState if advanced; ghost rows take
+// them from their halos, so no exchange is needed
+void DistributedSimState::UpdateCoefficients()
+{
+    bool advanced = params.advancedCoefficients;
+    for(int i = 0; i < size; i++){
+        float tempRatio = temp[i] / constants.airTemp;
+        float mixedTemp = constants.MixedTemperature(dens[i], temp[i]);
+        visc_coeff[i] = advanced ? constants.visc * sqrt(mixedTemp / constants.airTemp) / constants.MixedDensityAtAirTemp(dens[i])
+                                 : constants.visc;
+        diff_coeff[i] = advanced ? constants.diff * sqrt(tempRatio) * tempRatio : constants.diff;
+    }
+}
+
+// Fill thermal diffusivity of every cell held here at heated temperature, as in SimState
+void DistributedSimState::UpdateThermalCoefficients()
+{
+    bool advanced = params.advancedCoefficients;
+    for(int i = 0; i < size; i++){
+        diffTemp_coeff[i] = advanced ? constants.diffTemp * sqrt(temp[i] / constants.airTemp) : constants.diffTemp;
+    }
+}
+
+// Add source values into field, over ghost cells too as in SimState
+void DistributedSimState::AddSource(float * x, float * s, float dt)
+{
+    for(int i = 0; i < size; i++){
+        x[i] = x[i] + dt * s[i];
+    }
+}
+
+// Add heat source via maximum temp, as in SimState
+void DistributedSimState::AddHeatSource(float * t, float * s)
+{
+    for(int i = 0; i < size; i++){
+        t[i] = max(t[i], s[i]);
+    }
+}
+
+// Decay field toward equilibrium, slower in hot cells when fallOff is set; every cell
+// decays on its own, so ghost rows stay as their neighbors would leave them
+void DistributedSimState::Dissipate(float * x, float eqVal, float rate, float fallOff, float dt)
+{
+    float d = rate * dt;
+    for(int i = 0; i < size; i++){
+        x[i] = x[i] - d * (1. - fallOff * (temp[i] - constants.airTemp)) * (x[i] - eqVal);
+    }
+}
+
+// Perform thermal and gravitational convection
+void DistributedSimState::Convect(float dt)
+{
+    float g = dt * constants.grav;
+    bool temperature = params.temperatureOn;
+    for(int j = 1; j <= rows; j++){
+        for(int i = 1; i <= Nx; i++){
+            float density = temperature ? constants.MixedDensity(dens[ind(i,j)], temp[ind(i,j)])
+                                        : constants.MixedDensityAtAirTemp(dens[ind(i,j)]);
+            float bForce = density == 0.0 ? 1.0 : (density - constants.airDens) / density;
+            yVel[ind(i,j)] += g * bForce;
+        }
+    }
+}
+
+// Diffuse x0 into x by red-black sweeps with coefficients of each cell, starting from
+// the undiffused field
+template<int b>
+void DistributedSimState::Diffuse(float * x, float * x0, float * coeff, float dt)
+{
+    // Adjust a to account for cell size and timestep
+    float cellSize = params.lengthScale / Nx;
+    float a = dt / (cellSize * cellSize);
+
+    // Start from undiffused field, with halo rows brought up to date
+    std::copy(x0, x0 + size, x);
+    StartExchange(x);
+    FinishExchange();
+
+    // Source norm for relative residual
+    bool checkResidual = params.residualCheckInterval > 0;
+    double rhsNorm = 0;
+    if(checkResidual){
+        rhsNorm = sqrt(RowSum([&](int j){
+            double sum = 0;
+            for(int i = 1; i <= Nx; i++){
+                sum += SumSquares(x0[ind(i,j)]);
+            }
+            return sum;
+        }));
+    }
+
+    auto relax = [&](int i, int j){
+        float a_t = a * coeff[ind(i,j)];
+        x[ind(i,j)] = (x0[ind(i,j)] +
+        a_t*(x[ind(i-1,j)] + x[ind(i+1,j)] + x[ind(i,j-1)] + x[ind(i,j+1)])) / (1 + 4*a_t);
+    };
+
+    for(int k = 0; k < params.solverSteps; k++){
+
+        // Measure residual every few sweeps and stop once converged
+        if(checkResidual && k % params.residualCheckInterval == 0){
+            double resNorm = sqrt(RowSum([&](int j){
+                double sum = 0;
+                for(int i = 1; i <= Nx; i++){
+                    float a_t = a * coeff[ind(i,j)];
+                    float r = x0[ind(i,j)] - (1 + 4*a_t) * x[ind(i,j)] +
+                              a_t*(x[ind(i-1,j)] + x[ind(i+1,j)] + x[ind(i,j-1)] + x[ind(i,j+1)]);
+                    sum += SumSquares(r);
+                }
+                return sum;
+            }));
+            if((rhsNorm > 0 ? resNorm / rhsNorm : resNorm) <= params.solverTolerance){
+                break;
+            }
+        }
+
+        Sweep(x, 0, relax);
+        Sweep(x, 1, relax);
+        SetWalls<b>(x);
+    }
+}
+
+// Remove divergence of velocity by relaxing pressure p, then subtracting its gradient
+void DistributedSimState::HodgeProjection(float * u, float * v, float * p)
+{
+    // Adjust for cell size
+    float cellSize = params.lengthScale / Nx;
+
+    // Calculate divergence in each cell
+    for(int j = 1; j <= rows; j++){
+        for(int i = 1; i <= Nx; i++){
+            div[ind(i,j)] = -0.5 * cellSize * (u[ind(i+1,j)]-u[ind(i-1,j)]+
+                                               v[ind(i,j+1)]-v[ind(i,j-1)]);
+        }
+    }
+
+    // Seed with last solution, or start from zero
+    if(!params.warmStartPressure){
+        std::fill(p, p + size, 0.0f);
+    }
+    SetBoundary<0>(p);
+
+    RelaxPressure(p);
+
+    // Keep warm-started pressure centered, as only its gradient matters
+    if(params.warmStartPressure){
+        RemoveMean(p);
+    }
+
+    // Subtract pressure gradient, exchanging velocity halos behind the edge rows
+    float * velocities[] = { u, v };
+    UpdateRows(velocities, 2, [&](int j){
+        for(int i = 1; i <= Nx; i++){
+            u[ind(i,j)] -= 0.5 * (p[ind(i+1,j)] - p[ind(i-1,j)]) / cellSize;
+            v[ind(i,j)] -= 0.5 * (p[ind(i,j+1)] - p[ind(i,j-1)]) / cellSize;
+        }
+    });
+    SetWalls<1>(u);
+    SetWalls<2>(v);
+}
+
+// Relax pressure toward solution for divergence by red-black sweeps
+void DistributedSimState::RelaxPressure(float * p)
+{
+    // Source norm for relative residual
+    bool checkResidual = params.residualCheckInterval > 0;
+    double rhsNorm = 0;
+    if(checkResidual){
+        rhsNorm = sqrt(RowSum([&](int j){
+            double sum = 0;
+            for(int i = 1; i <= Nx; i++){
+                sum += SumSquares(div[ind(i,j)]);
+            }
+            return sum;
+        }));
+    }
+
+    auto relax = [&](int i, int j){
+        p[ind(i,j)] = (div[ind(i,j)] + p[ind(i-1,j)] + p[ind(i+1,j)] +
+                                       p[ind(i,j-1)] + p[ind(i,j+1)])/4;
+    };
+
+    for(int k = 0; k < params.solverSteps; k++){
+
+        // Measure residual every few sweeps and stop once converged
+        if(checkResidual && k % params.residualCheckInterval == 0){
+            if(PressureResidual(p, rhsNorm) <= params.solverTolerance){
+                break;
+            }
+        }
+
+        Sweep(p, 0, relax);
+        Sweep(p, 1, relax);
+        SetWalls<0>(p);
+    }
+}
+
+// Norm of pressure residual over the whole grid relative to divergence norm
+float DistributedSimState::PressureResidual(float * p, double rhsNorm)
+{
+    double resNorm = sqrt(RowSum([&](int j){
+        double sum = 0;
+        for(int i = 1; i <= Nx; i++){
+            float r = div[ind(i,j)] - 4 * p[ind(i,j)] + p[ind(i-1,j)] + p[ind(i+1,j)] +
+                                                        p[ind(i,j-1)] + p[ind(i,j+1)];
+            sum += SumSquares(r);
+        }
+        return sum;
+    }));
+
+    return rhsNorm > 0 ? resNorm / rhsNorm : resNorm;
+}
+
+// Subtract average over interior cells of the whole grid from field, including ghost cells
+void DistributedSimState::RemoveMean(float * x)
+{
+    float mean = float(RowSum([&](int j){
+        double sum = 0;
+        for(int i = 1; i <= Nx; i++){
+            sum += double(x[ind(i,j)]);
+        }
+        return sum;
+    }) / (double(Nx) * Ny));
+
+    for(int i = 0; i < size; i++){
+        x[i] -= mean;
+    }
+}
+
+// Advect fields d0 into d along velocity (u, v) by semi-Lagrangian steps, exchanging
+// halos of d behind the edge rows; walls are left to the caller. Departure points are
+// kept within the grid, as in SimState, and within a row of the cell, so they never
+// reach past the halo rows
+void DistributedSimState::Advect(float ** d, float ** d0, int count, float * u, float * v, float dt)
+{
+    // Adjust dt to account for cell size
+    float cellSize = params.lengthScale / Nx;
+    float dt0 = dt / cellSize;
+
+    UpdateRows(d, count, [&](int j){
+        int jGlobal = rowStart - 1 + j;
+        for(int i = 1; i <= Nx; i++){
+
+            // Calculate origin coordinates, in global rows
+            float x = i - dt0 * u[ind(i,j)];
+            float y = jGlobal - dt0 * v[ind(i,j)];
+
+            // Discretize into adjacent grid elements
+            if(x <      0.5) { x =      0.5; }
+            if(x > Nx + 0.5) { x = Nx + 0.5; }
+            int i0 = (int)x;
+
+            if(y <      0.5) { y =      0.5; }
+            if(y > Ny + 0.5) { y = Ny + 0.5; }
+            y = min(max(y, float(jGlobal - 1)), float(jGlobal + 1));
+            int j0 = (int)y;
+
+            float s1 = x - i0;
+            float t1 = y - j0;
+
+            // Sample the row below instead of weighting a row past the halo by zero
+            j0 -= rowStart - 1;
+            if(j0 > j){
+                j0 = j;
+                t1 = 1;
+            }
+
+            int i1 = i0 + 1;
+            int j1 = j0 + 1;
+            float s0 = 1 - s1;
+            float t0 = 1 - t1;
+
+            // Calculate new values due to advection
+            for(int f = 0; f < count; f++){
+                d[f][ind(i,j)] = s0 * (t0 * d0[f][ind(i0,j0)] + t1 * d0[f][ind(i0,j1)]) +
+                                 s1 * (t0 * d0[f][ind(i1,j0)] + t1 * d0[f][ind(i1,j1)]);
+            }
+        }
+    });
+}
+
+// Collected methods for velocity calculation
+template<bool closed>
+void DistributedSimState::VelocityStep(float dt)
+{
+    // Generate sources
+    AddSource(xVel, xVel_source, dt);
+    AddSource(yVel, yVel_source, dt);
+
+    // Perform gravitational acceleration
+    if(params.gravityOn && constants.grav != 0.0){
+        Convect(dt);
+    }
+
+    // Perform velocity diffusion
+    swap(xVel_prev, xVel);
+    Diffuse<closed ? 1 : 0>(xVel, xVel_prev, visc_coeff, dt);
+    swap(yVel_prev, yVel);
+    Diffuse<closed ? 2 : 0>(yVel, yVel_prev, visc_coeff, dt);
+
+    // Perform Hodge projection to remove divergence
+    HodgeProjection(xVel, yVel, pres);
+
+    // Perform velocity advection
+    swap(xVel_prev, xVel);
+    swap(yVel_prev, yVel);
+    float * velocities[] = { xVel, yVel };
+    float * velocities_prev[] = { xVel_prev, yVel_prev };
+    Advect(velocities, velocities_prev, 2, xVel_prev, yVel_prev, dt);
+    SetWalls<closed ? 1 : 0>(xVel);
+    SetWalls<closed ? 2 : 0>(yVel);
+
+    // Perform Hodge projection again
+    HodgeProjection(xVel, yVel, pres_advect);
+}
+
+// Collected methods for density calculation
+template<bool closed>
+void DistributedSimState::DensityStep(float dt)
+{
+    AddSource(dens, dens_source, dt);
+
+    swap(dens_prev, dens);
+    Diffuse<closed ? 0 : -1>(dens, dens_prev, diff_coeff, dt);
+
+    if(constants.densDecay > 0.0){
+        Dissipate(dens, 0.0, constants.densDecay, constants.tempFactor, dt);
+    }
+}
+
+// Collected methods for temperature calculation
+void DistributedSimState::TemperatureStep(float dt)
+{
+    AddHeatSource(temp, temp_source);
+
+    // Evaluate thermal diffusivity at heated temperature
+    UpdateThermalCoefficients();
+
+    swap(temp_prev, temp);
+    Diffuse<0>(temp, temp_prev, diffTemp_coeff, dt);
+
+    if(constants.tempDecay > 0.0){
+        Dissipate(temp, constants.airTemp, constants.tempDecay, 0.0, dt);
+    }
+}
+
+// Advect all scalars along streamlines in one pass
+template<bool closed>
+void DistributedSimState::ScalarAdvectionStep(float dt)
+{
+    swap(dens_prev, dens);
+    swap(temp_prev, temp);
+    float * scalars[] = { dens, temp };
+    float * scalars_prev[] = { dens_prev, temp_prev };
+    Advect(scalars, scalars_prev, params.temperatureOn ? 2 : 1, xVel, yVel, dt);
+    SetWalls<closed ? 0 : -1>(dens);
+
+    // Temperature stays where it was when not simulated
+    if(params.temperatureOn){
+        SetWalls<0>(temp);
+    }else{
+        swap(temp_prev, temp);
+    }
+}
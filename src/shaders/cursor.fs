@@ -8,11 +8,12 @@ uniform int shape;
 uniform float xPos;
 uniform float yPos;
 uniform float size;
+uniform float aspect;
 
 void main()
 {
     float xDist = abs(xPos - TexCoord.x);
-    float yDist = abs(yPos - TexCoord.y);
+    float yDist = abs(yPos - TexCoord.y) * aspect;
 
     float dist;
     vec4 color;